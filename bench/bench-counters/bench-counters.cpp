@@ -0,0 +1,191 @@
+#include "bench-counters.hpp"
+#include <openssl/crypto.h>
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// plain thread_locals without constructors, usable from operator new during startup
+static thread_local bool counting = false;
+static thread_local BenchCounts counts;
+
+void startCounting()
+{
+    counts = BenchCounts();
+    counting = true;
+}
+
+BenchCounts stopCounting()
+{
+    counting = false;
+    return counts;
+}
+
+static inline void countAllocation(size_t size)
+{
+    if (counting)
+    {
+        counts.allocations++;
+        counts.allocatedBytes += size;
+    }
+}
+
+static inline void countSyscall()
+{
+    if (counting)
+        counts.syscalls++;
+}
+
+// the global allocation functions are replaced for the whole benchmark binary
+void *operator new(size_t size)
+{
+    countAllocation(size);
+    if (void *p = malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    countAllocation(size);
+    return malloc(size ? size : 1);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+    return operator new(size, std::nothrow);
+}
+
+void *operator new(size_t size, std::align_val_t align)
+{
+    countAllocation(size);
+    size_t alignment = std::max(static_cast<size_t>(align), sizeof(void *));
+    void *p = nullptr;
+    if (posix_memalign(&p, alignment, size ? size : 1) == 0)
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size, std::align_val_t align)
+{
+    return operator new(size, align);
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { free(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept { free(p); }
+void operator delete[](void *p, size_t, std::align_val_t) noexcept { free(p); }
+
+static void *countingMalloc(size_t size, const char *, int)
+{
+    countAllocation(size);
+    return malloc(size);
+}
+
+static void *countingRealloc(void *p, size_t size, const char *, int)
+{
+    countAllocation(size);
+    return realloc(p, size);
+}
+
+static void countingFree(void *p, const char *, int)
+{
+    free(p);
+}
+
+bool countOpenSslAllocations()
+{
+    return CRYPTO_set_mem_functions(countingMalloc, countingRealloc, countingFree) == 1;
+}
+
+// the I/O calls are defined in the executable so every caller, OpenSSL's socket BIO
+// included, ends up here. they forward to the kernel through syscall() directly
+extern "C"
+{
+    ssize_t read(int fd, void *buf, size_t count)
+    {
+        countSyscall();
+        return syscall(SYS_read, fd, buf, count);
+    }
+
+    ssize_t write(int fd, const void *buf, size_t count)
+    {
+        countSyscall();
+        return syscall(SYS_write, fd, buf, count);
+    }
+
+    ssize_t readv(int fd, const struct iovec *iov, int iovcnt)
+    {
+        countSyscall();
+        return syscall(SYS_readv, fd, iov, iovcnt);
+    }
+
+    ssize_t writev(int fd, const struct iovec *iov, int iovcnt)
+    {
+        countSyscall();
+        return syscall(SYS_writev, fd, iov, iovcnt);
+    }
+
+    ssize_t recv(int fd, void *buf, size_t len, int flags)
+    {
+        countSyscall();
+        return syscall(SYS_recvfrom, fd, buf, len, flags, nullptr, nullptr);
+    }
+
+    ssize_t send(int fd, const void *buf, size_t len, int flags)
+    {
+        countSyscall();
+        return syscall(SYS_sendto, fd, buf, len, flags, nullptr, 0);
+    }
+
+    ssize_t recvfrom(int fd, void *buf, size_t len, int flags, struct sockaddr *address, socklen_t *length)
+    {
+        countSyscall();
+        return syscall(SYS_recvfrom, fd, buf, len, flags, address, length);
+    }
+
+    ssize_t sendto(int fd, const void *buf, size_t len, int flags, const struct sockaddr *address, socklen_t length)
+    {
+        countSyscall();
+        return syscall(SYS_sendto, fd, buf, len, flags, address, length);
+    }
+
+    ssize_t recvmsg(int fd, struct msghdr *message, int flags)
+    {
+        countSyscall();
+        return syscall(SYS_recvmsg, fd, message, flags);
+    }
+
+    ssize_t sendmsg(int fd, const struct msghdr *message, int flags)
+    {
+        countSyscall();
+        return syscall(SYS_sendmsg, fd, message, flags);
+    }
+
+    int poll(struct pollfd *fds, nfds_t nfds, int timeout)
+    {
+        countSyscall();
+        struct timespec limit = {timeout / 1000, (timeout % 1000) * 1000000L};
+        return syscall(SYS_ppoll, fds, nfds, timeout < 0 ? nullptr : &limit, nullptr, 0);
+    }
+
+    int epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout)
+    {
+        countSyscall();
+        return syscall(SYS_epoll_pwait, epfd, events, maxevents, timeout, nullptr, 0);
+    }
+}
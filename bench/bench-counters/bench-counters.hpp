@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// what the calling thread did between startCounting and stopCounting
+struct BenchCounts
+{
+    uint64_t syscalls = 0;       // socket and fd I/O calls, the ones the transfer loop makes per read
+    uint64_t allocations = 0;    // operator new plus OpenSSL's own mallocs
+    uint64_t allocatedBytes = 0;
+};
+
+// counting is per thread so the loopback server threads dont show up in the numbers
+void startCounting();
+BenchCounts stopCounting();
+
+// route OpenSSL's allocations through the counters, has to run before OpenSSL allocates anything
+bool countOpenSslAllocations();
@@ -0,0 +1,277 @@
+#include "loopback-server.hpp"
+
+// sends over a plain fd or an SSL stream, the server doesnt need the client socket classes
+struct Connection
+{
+    int fd;
+    SSL *ssl;
+
+    bool sendAll(const char *data, size_t size)
+    {
+        while (size > 0)
+        {
+            ssize_t n = ssl ? SSL_write(ssl, data, (int)std::min(size, (size_t)1 << 30)) : send(fd, data, size, MSG_NOSIGNAL);
+            if (n <= 0)
+                return false;
+            data += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    ssize_t receive(char *data, size_t size)
+    {
+        return ssl ? SSL_read(ssl, data, (int)size) : recv(fd, data, size, 0);
+    }
+};
+
+// value of name=... in the query, fallback when it is missing
+static std::string queryValue(const std::string &target, const std::string &name, const std::string &fallback)
+{
+    size_t pos = target.find("?" + name + "=");
+    if (pos == std::string::npos)
+        pos = target.find("&" + name + "=");
+    if (pos == std::string::npos)
+        return fallback;
+
+    pos += name.size() + 2;
+    return target.substr(pos, target.find('&', pos) - pos);
+}
+
+LoopbackServer::LoopbackServer(bool tls)
+    : listenFd(-1), port(0), ctx(nullptr), acceptor(), running(true), mutex(), connections(), openFds(),
+      pattern(LOOPBACK_BLOCK_SIZE, '\0')
+{
+    for (size_t i = 0; i < pattern.size(); i++)
+        pattern[i] = 'a' + i % 26;
+
+    if (tls)
+        ctx = makeSelfSignedContext();
+
+    listenFd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int yes = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;
+
+    socklen_t length = sizeof(address);
+    if (bind(listenFd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 || listen(listenFd, 128) < 0 ||
+        getsockname(listenFd, reinterpret_cast<sockaddr *>(&address), &length) < 0)
+        throw std::runtime_error(std::string("loopback server failed to listen: ") + strerror(errno));
+
+    port = ntohs(address.sin_port);
+    acceptor = std::thread(&LoopbackServer::acceptLoop, this);
+}
+
+LoopbackServer::~LoopbackServer()
+{
+    running = false;
+    shutdown(listenFd, SHUT_RDWR);
+    acceptor.join();
+    close(listenFd);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int fd : openFds)
+            shutdown(fd, SHUT_RDWR);
+    }
+    for (std::thread &connection : connections)
+        connection.join();
+
+    if (ctx)
+        SSL_CTX_free(ctx);
+}
+
+int LoopbackServer::getPort() const
+{
+    return port;
+}
+
+std::string LoopbackServer::url(size_t size, size_t chunk, size_t headers, const std::string &mode) const
+{
+    return std::string(ctx ? "https" : "http") + "://127.0.0.1:" + std::to_string(port) + "/data?size=" +
+           std::to_string(size) + "&chunk=" + std::to_string(chunk) + "&headers=" + std::to_string(headers) +
+           "&mode=" + mode;
+}
+
+void LoopbackServer::acceptLoop()
+{
+    while (running)
+    {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            if (!running)
+                return;
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        openFds.push_back(fd);
+        connections.emplace_back(&LoopbackServer::serve, this, fd);
+    }
+}
+
+// answer requests on the connection till the client or the response closes it
+void LoopbackServer::serve(int fd)
+{
+    int yes = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+
+    Connection connection{fd, nullptr};
+    if (ctx)
+    {
+        connection.ssl = SSL_new(ctx);
+        SSL_set_fd(connection.ssl, fd);
+        if (SSL_accept(connection.ssl) <= 0)
+        {
+            SSL_free(connection.ssl);
+            close(fd);
+            return;
+        }
+    }
+
+    std::string request;
+    char buffer[16384];
+    bool open = true;
+
+    while (open && running)
+    {
+        size_t end;
+        while ((end = request.find("\r\n\r\n")) == std::string::npos)
+        {
+            ssize_t n = connection.receive(buffer, sizeof(buffer));
+            if (n <= 0)
+            {
+                open = false;
+                break;
+            }
+            request.append(buffer, n);
+        }
+        if (!open)
+            break;
+
+        std::string head = request.substr(0, end);
+        request.erase(0, end + 4);
+
+        std::string target = head.substr(head.find(' ') + 1);
+        target = target.substr(0, target.find(' '));
+
+        size_t size = std::stoull(queryValue(target, "size", "0"));
+        size_t chunk = std::max<size_t>(1, std::stoull(queryValue(target, "chunk", "65536")));
+        size_t headerSize = std::stoull(queryValue(target, "headers", "0"));
+        std::string mode = queryValue(target, "mode", "length");
+        bool keepAlive = head.find("Connection: keep-alive") != std::string::npos && mode != "close";
+
+        std::string response = "HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\n";
+        response += keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+        if (mode == "length")
+            response += "Content-Length: " + std::to_string(size) + "\r\n";
+        else if (mode == "chunked")
+            response += "Transfer-Encoding: chunked\r\n";
+
+        // Padding headers, har ek lagbhag 100 bytes ka
+        for (size_t i = 0; response.size() < headerSize; i++)
+            response += "X-Padding-" + std::to_string(i) + ": " + std::string(80, 'p') + "\r\n";
+        response += "\r\n";
+
+        if (!connection.sendAll(response.data(), response.size()))
+            break;
+
+        if (mode == "chunked")
+        {
+            // a block of whole chunks is framed once and sent again and again
+            char hex[32];
+            snprintf(hex, sizeof(hex), "%zx\r\n", chunk);
+
+            std::string block;
+            size_t perBlock = std::max<size_t>(1, LOOPBACK_BLOCK_SIZE / chunk);
+            for (size_t i = 0; i < perBlock; i++)
+            {
+                block += hex;
+                block.append(pattern.data(), std::min(chunk, pattern.size()));
+                if (chunk > pattern.size())
+                    block.append(chunk - pattern.size(), 'z');
+                block += "\r\n";
+            }
+
+            size_t remaining = size;
+            size_t blockBytes = perBlock * chunk;
+            while (open && remaining >= blockBytes)
+            {
+                open = connection.sendAll(block.data(), block.size());
+                remaining -= blockBytes;
+            }
+
+            // whatever doesnt fill a block goes out chunk by chunk
+            std::string tail;
+            while (remaining > 0)
+            {
+                size_t n = std::min(remaining, chunk);
+                snprintf(hex, sizeof(hex), "%zx\r\n", n);
+                tail += hex;
+                tail.append(n, 'x');
+                tail += "\r\n";
+                remaining -= n;
+            }
+            tail += "0\r\n\r\n";
+            open = open && connection.sendAll(tail.data(), tail.size());
+        }
+        else
+        {
+            for (size_t sent = 0; open && sent < size; sent += LOOPBACK_BLOCK_SIZE)
+                open = connection.sendAll(pattern.data(), std::min(size - sent, (size_t)LOOPBACK_BLOCK_SIZE));
+        }
+
+        if (!keepAlive)
+            break;
+    }
+
+    if (connection.ssl)
+    {
+        SSL_shutdown(connection.ssl);
+        SSL_free(connection.ssl);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::erase(openFds, fd);
+    }
+    close(fd);
+}
+
+// a P-256 key and a certificate for localhost signed by itself, valid for a day
+SSL_CTX *LoopbackServer::makeSelfSignedContext()
+{
+    EVP_PKEY *key = EVP_EC_gen("P-256");
+    X509 *cert = X509_new();
+    if (!key || !cert)
+        throw std::runtime_error("failed to create the benchmark certificate");
+
+    X509_set_version(cert, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 24 * 60 * 60);
+    X509_set_pubkey(cert, key);
+
+    X509_NAME *name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char *>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+
+    if (X509_sign(cert, key, EVP_sha256()) == 0)
+        throw std::runtime_error("failed to sign the benchmark certificate");
+
+    SSL_CTX *ctx = SSL_CTX_new(TLS_server_method());
+    if (!ctx || SSL_CTX_use_certificate(ctx, cert) != 1 || SSL_CTX_use_PrivateKey(ctx, key) != 1)
+    {
+        ERR_print_errors_fp(stderr);
+        throw std::runtime_error("failed to set up the benchmark TLS context");
+    }
+
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    return ctx;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define LOOPBACK_BLOCK_SIZE (1024 * 1024) // body bytes are sent from a prebuilt block of this size
+
+// a stand-in HTTP server on 127.0.0.1 for the benchmarks. a request for
+//   /data?size=<bytes>&chunk=<bytes>&headers=<bytes>&mode=length|chunked|close
+// is answered with size body bytes, framed by Content-Length, as chunks of
+// the given size or by closing the connection, after padding headers of
+// about the given size. with tls the server uses a self-signed certificate
+// made at startup. every connection is served by a thread of its own.
+class LoopbackServer
+{
+    int listenFd;
+    int port;
+    SSL_CTX *ctx; // nullptr for plain HTTP
+    std::thread acceptor;
+    std::atomic<bool> running;
+    std::mutex mutex;
+    std::vector<std::thread> connections;
+    std::vector<int> openFds; // closed on shutdown so blocked connection threads return
+    std::string pattern;      // LOOPBACK_BLOCK_SIZE body bytes
+
+public:
+    explicit LoopbackServer(bool tls);
+    ~LoopbackServer();
+    LoopbackServer(const LoopbackServer &) = delete;
+    LoopbackServer &operator=(const LoopbackServer &) = delete;
+
+    int getPort() const;
+    std::string url(size_t size, size_t chunk, size_t headers, const std::string &mode) const;
+
+private:
+    void acceptLoop();
+    void serve(int fd);
+    static SSL_CTX *makeSelfSignedContext();
+};
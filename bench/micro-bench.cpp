@@ -0,0 +1,195 @@
+#include "bench-counters/bench-counters.hpp"
+#include "../src/http/http-request/http-request.hpp"
+#include "../src/http/http-response/http-response.hpp"
+#include "../src/utils/utils.hpp"
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#define MICROBENCH_MIN_SECONDS 0.2 // every case is repeated till a run takes at least this long
+
+// urls as they show up in batch lists, with queries, ports and long paths
+static const std::vector<std::string> URLS = {
+    "http://example.com",
+    "http://example.com/",
+    "https://example.com/index.html",
+    "https://downloads.example.org/releases/v2.4.1/tool-2.4.1-linux-x86_64.tar.gz",
+    "http://127.0.0.1:8080/files/report.pdf",
+    "https://cdn.example.net/assets/images/2024/05/header-background@2x.png?v=3f2a9c",
+    "https://mirror.example.edu:8443/pub/linux/distributions/iso/netinst-amd64.iso",
+    "http://api.example.com/v1/export?format=csv&from=2024-01-01&to=2024-12-31&page=17",
+    "https://objects.example.com/bucket/a/b/c/d/e/f/0123456789abcdef0123456789abcdef.bin#part",
+    "https://example.com/path%20with%20spaces/file%20name.txt",
+};
+
+// Content-Disposition values, empty ones make the name come from the url
+static const std::vector<std::string> DISPOSITIONS = {
+    "",
+    "attachment",
+    "inline",
+    "attachment; filename=\"report.pdf\"",
+    "attachment; filename = \"tool-2.4.1-linux-x86_64.tar.gz\"",
+    "inline; filename=\"photo.jpg\"; size=123456",
+    "attachment; filename=\"quarterly results (final).xlsx\"; filename*=UTF-8''quarterly%20results.xlsx",
+    "form-data; name=\"file\"; filename=\"upload.bin\"",
+};
+
+static const std::vector<std::string> CONTENT_TYPES = {
+    "application/octet-stream",
+    "text/html; charset=utf-8",
+    "application/pdf",
+    "image/png",
+};
+
+// comma separated values as they come in headers and batch lines
+static const std::vector<std::string> LISTS = {
+    "gzip, deflate, br",
+    "bytes",
+    "no-cache, no-store, must-revalidate, max-age=0",
+    "https://example.com/a.bin high",
+    "a,b,c,d,e,f,g,h,i,j,k,l,m,n,o,p",
+};
+
+// response heads of a small file server, a CDN and an object store
+static const std::vector<std::string> RESPONSES = {
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/plain\r\n"
+    "Content-Length: 12\r\n"
+    "\r\n"
+    "hello world\n",
+
+    "HTTP/1.1 200 OK\r\n"
+    "Date: Mon, 06 May 2024 10:12:45 GMT\r\n"
+    "Server: nginx/1.24.0\r\n"
+    "Content-Type: application/octet-stream\r\n"
+    "Content-Length: 104857600\r\n"
+    "Last-Modified: Tue, 30 Apr 2024 08:00:00 GMT\r\n"
+    "Connection: keep-alive\r\n"
+    "ETag: \"6630a4c0-6400000\"\r\n"
+    "Accept-Ranges: bytes\r\n"
+    "\r\n",
+
+    "HTTP/1.1 206 Partial Content\r\n"
+    "Accept-Ranges: bytes\r\n"
+    "Age: 5123\r\n"
+    "Cache-Control: public, max-age=31536000, immutable\r\n"
+    "Content-Disposition: attachment; filename=\"tool-2.4.1-linux-x86_64.tar.gz\"\r\n"
+    "Content-Length: 1048576\r\n"
+    "Content-Range: bytes 1048576-2097151/52428800\r\n"
+    "Content-Type: application/gzip\r\n"
+    "Date: Mon, 06 May 2024 10:12:45 GMT\r\n"
+    "ETag: \"d41d8cd98f00b204e9800998ecf8427e\"\r\n"
+    "Last-Modified: Tue, 30 Apr 2024 08:00:00 GMT\r\n"
+    "Server: cdn-edge\r\n"
+    "Strict-Transport-Security: max-age=63072000; includeSubDomains; preload\r\n"
+    "Vary: Accept-Encoding\r\n"
+    "Via: 1.1 varnish, 1.1 varnish\r\n"
+    "X-Cache: HIT, HIT\r\n"
+    "X-Cache-Hits: 3, 17\r\n"
+    "X-Served-By: cache-fra-1, cache-ams-2\r\n"
+    "X-Timer: S1715000000.123456,VS0,VE1\r\n"
+    "\r\n",
+
+    "HTTP/1.1 200 OK\r\n"
+    "x-amz-id-2: 5Cj2cH+Zs9T0pGMb7Ni5c3xVw8y0fYc1k2Vb6mQ4lH0=\r\n"
+    "x-amz-request-id: 4A1B2C3D4E5F6A7B\r\n"
+    "Date: Mon, 06 May 2024 10:12:45 GMT\r\n"
+    "Last-Modified: Tue, 30 Apr 2024 08:00:00 GMT\r\n"
+    "ETag: \"9b2cf535f27731c974343645a3985328-12\"\r\n"
+    "x-amz-server-side-encryption: AES256\r\n"
+    "Content-Encoding: gzip\r\n"
+    "Transfer-Encoding: chunked\r\n"
+    "Content-Type: application/json\r\n"
+    "Server: AmazonS3\r\n"
+    "\r\n",
+};
+
+struct Case
+{
+    std::string name;
+    size_t corpus;                        // inputs per pass
+    std::function<size_t(size_t)> run;    // handles input i, returns something to keep the result alive
+};
+
+// a sum of the results so the compiler cant drop the calls
+static volatile size_t sink = 0;
+
+// runs the whole corpus often enough for a stable time, then reports the last run
+static void measure(const Case &benchCase)
+{
+    size_t passes = 1;
+    double seconds = 0;
+    BenchCounts counts;
+
+    while (true)
+    {
+        size_t total = 0;
+        auto started = std::chrono::steady_clock::now();
+        startCounting();
+
+        for (size_t pass = 0; pass < passes; pass++)
+            for (size_t i = 0; i < benchCase.corpus; i++)
+                total += benchCase.run(i);
+
+        counts = stopCounting();
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        sink = sink + total;
+
+        if (seconds >= MICROBENCH_MIN_SECONDS)
+            break;
+        passes *= seconds > 0 ? std::max<size_t>(2, MICROBENCH_MIN_SECONDS / seconds) : 10;
+    }
+
+    double ops = static_cast<double>(passes * benchCase.corpus);
+    std::cout << std::left << std::setw(28) << benchCase.name << std::right << std::fixed
+              << std::setw(14) << static_cast<size_t>(ops) << std::setprecision(1) << std::setw(12)
+              << seconds * 1e9 / ops << std::setprecision(2) << std::setw(12) << counts.allocations / ops
+              << std::setprecision(1) << std::setw(12) << counts.allocatedBytes / ops << std::endl;
+}
+
+int main(int argc, char const *argv[])
+{
+    // only cases whose name contains the filter are run
+    std::string filter = argc > 1 ? argv[1] : "";
+
+    // requests and responses are built up front so only the measured call is counted
+    std::vector<HttpRequest> requests;
+    for (const std::string &url : URLS)
+    {
+        ParsedUrl parsed = parseUrl(url);
+        HttpRequest request = HttpRequest::makeGetRequest(parsed.host, parsed.path);
+        request.setHeader({"Accept-Encoding", "gzip, deflate, br"});
+        requests.push_back(request);
+    }
+
+    std::vector<Case> cases = {
+        {"parseUrl", URLS.size(), [](size_t i)
+         { return parseUrl(URLS[i]).path.size(); }},
+        {"getFilenameAndExtension", DISPOSITIONS.size() * URLS.size(), [](size_t i)
+         {
+             auto [filename, extension] = getFilenameAndExtension(DISPOSITIONS[i % DISPOSITIONS.size()],
+                                                                  CONTENT_TYPES[i % CONTENT_TYPES.size()],
+                                                                  URLS[i / DISPOSITIONS.size()]);
+             return filename.size() + extension.size();
+         }},
+        {"split", LISTS.size(), [](size_t i)
+         { return split(LISTS[i], ',').size(); }},
+        {"HttpRequest::toString", requests.size(), [&requests](size_t i)
+         { return requests[i].toString().size(); }},
+        {"HttpResponse::parse", RESPONSES.size(), [](size_t i)
+         { return static_cast<size_t>(HttpResponse::parse(RESPONSES[i]).getStatusCode()); }},
+    };
+
+    std::cout << std::left << std::setw(28) << "function" << std::right << std::setw(14) << "ops"
+              << std::setw(12) << "ns/op" << std::setw(12) << "allocs/op" << std::setw(12) << "bytes/op" << std::endl;
+
+    for (const Case &benchCase : cases)
+    {
+        if (benchCase.name.find(filter) != std::string::npos)
+            measure(benchCase);
+    }
+    return 0;
+}
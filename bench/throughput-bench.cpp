@@ -0,0 +1,250 @@
+#include "bench-counters/bench-counters.hpp"
+#include "loopback-server/loopback-server.hpp"
+#include "../src/http/http-request/http-request.hpp"
+#include "../src/http/http-response/http-response.hpp"
+#include "../src/http/http-stream-reader/http-stream-reader.hpp"
+#include "../src/metrics/transfer-metrics/transfer-metrics.hpp"
+#include "../src/socket-lib/socket-factory/socket-factory.hpp"
+#include "../src/utils/utils.hpp"
+#include <chrono>
+#include <fcntl.h>
+#include <iomanip>
+#include <iostream>
+#include <signal.h>
+#include <string>
+#include <vector>
+
+// which reader call consumes the body
+enum class BodyPath
+{
+    SpecifiedLength, // readSpecifiedChunkedContent, also used for bodies ending at close
+    Chunked,         // readChunkedContent
+    WholeContent,    // readContent, the body ends up in one string
+    Splice,          // spliceContent to /dev/null, needs plain TCP or kernel TLS
+};
+
+struct Scenario
+{
+    std::string name;
+    size_t size;     // body bytes per request
+    size_t chunk;    // chunk size for chunked bodies
+    size_t headers;  // approximate header block size
+    std::string mode; // framing asked from the server, length, chunked or close
+    BodyPath path;
+    size_t requests; // sent one after the other over a keep-alive connection
+};
+
+struct Result
+{
+    size_t bytes;
+    double seconds;
+    BenchCounts counts;
+    bool kernelTls; // the records were decrypted by the kernel
+    bool skipped;   // the path isnt usable over this socket
+};
+
+// 64M, 512K or a plain byte count
+static size_t parseSize(const std::string &value)
+{
+    size_t pos = 0;
+    size_t size = std::stoull(value, &pos);
+    std::string suffix = value.substr(pos);
+
+    if (suffix == "K" || suffix == "k")
+        return size << 10;
+    if (suffix == "M" || suffix == "m")
+        return size << 20;
+    if (suffix == "G" || suffix == "g")
+        return size << 30;
+    if (!suffix.empty())
+        throw std::runtime_error("invalid size " + value);
+    return size;
+}
+
+// receive the scenario's responses over the real sockets and reader, counting the client thread only
+static Result run(const LoopbackServer &server, const Scenario &scenario)
+{
+    ParsedUrl url = parseUrl(server.url(scenario.size, scenario.chunk, scenario.headers, scenario.mode));
+    bool keepAlive = scenario.mode != "close";
+    HttpRequest request = HttpRequest::makeGetRequest(url.host, url.path, keepAlive);
+    std::string requestText = request.toString();
+
+    int devNull = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    uint64_t kernelTlsBefore = Metrics::instance().get(Counter::TlsKernelReceive);
+    uint64_t receivedBefore = Metrics::instance().get(Counter::BytesReceived);
+    auto started = std::chrono::steady_clock::now();
+    startCounting();
+
+    std::shared_ptr<ISocket> sock;
+    HttpStreamReader reader(nullptr);
+    size_t body = 0;
+
+    for (size_t i = 0; i < scenario.requests; i++)
+    {
+        if (!sock || !keepAlive)
+        {
+            if (sock)
+                sock->closeConnection();
+            sock = createSocket(url);
+            sock->connectToServer();
+            reader = HttpStreamReader(sock);
+            reader.setProgressLogging(false);
+
+            if (scenario.path == BodyPath::Splice && sock->getRawFd() < 0)
+            {
+                stopCounting();
+                sock->closeConnection();
+                close(devNull);
+                return {0, 0, BenchCounts(), false, true};
+            }
+        }
+
+        sock->sendAll(requestText);
+
+        HttpResponse res;
+        reader.readResponse(res);
+
+        std::string contentLength(res.getHeader(Headers::ContentLength));
+        size_t length = contentLength.empty() ? 0 : std::stoull(contentLength);
+
+        // the data is only counted, like a sink that discards it
+        switch (scenario.path)
+        {
+        case BodyPath::SpecifiedLength:
+            reader.readSpecifiedChunkedContent(length, [&body](const std::string &data)
+                                               { body += data.size(); });
+            break;
+        case BodyPath::Chunked:
+            reader.readChunkedContent([&body](std::string_view data)
+                                      { body += data.size(); });
+            break;
+        case BodyPath::WholeContent:
+            body += reader.readContent(length).size();
+            break;
+        case BodyPath::Splice:
+        {
+            // what came along with the headers is dropped the way a sink would write it
+            size_t buffered = std::min(reader.getBuffered().size(), length);
+            reader.consume(buffered);
+            body += buffered + reader.spliceContent(devNull, 0, length - buffered);
+            break;
+        }
+        }
+    }
+    sock->closeConnection();
+
+    BenchCounts counts = stopCounting();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    close(devNull);
+
+    if (body != scenario.size * scenario.requests)
+        throw std::runtime_error(scenario.name + " received " + std::to_string(body) + " of " +
+                                 std::to_string(scenario.size * scenario.requests) + " body bytes");
+
+    return {Metrics::instance().get(Counter::BytesReceived) - receivedBefore, seconds, counts,
+            Metrics::instance().get(Counter::TlsKernelReceive) > kernelTlsBefore, false};
+}
+
+static void printUsage(const char *program)
+{
+    std::cerr << "usage: " << program << " [--size N[K|M|G]] [--scheme http|https|both]" << std::endl;
+}
+
+int main(int argc, char const *argv[])
+{
+    // before anything touches OpenSSL, its allocations are counted only when set up first
+    if (!countOpenSslAllocations())
+        std::cerr << "OpenSSL allocations are not counted" << std::endl;
+
+    // the server may still write a session ticket to a connection the client dropped
+    signal(SIGPIPE, SIG_IGN);
+
+    size_t size = 64 << 20;
+    std::string scheme = "both";
+
+    try
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            if ((arg == "--size" || arg == "--scheme") && i + 1 >= argc)
+                throw std::runtime_error(arg + " needs a value");
+
+            if (arg == "--size")
+                size = parseSize(argv[++i]);
+            else if (arg == "--scheme")
+                scheme = argv[++i];
+            else
+                throw std::runtime_error("unknown option " + arg);
+        }
+        if (scheme != "http" && scheme != "https" && scheme != "both")
+            throw std::runtime_error("invalid scheme " + scheme);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << '\n';
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::vector<Scenario> scenarios = {
+        {"content-length", size, 0, 0, "length", BodyPath::SpecifiedLength, 1},
+        {"until-close", size, 0, 0, "close", BodyPath::SpecifiedLength, 1},
+        {"chunked-64k", size, 64 << 10, 0, "chunked", BodyPath::Chunked, 1},
+        {"chunked-1k", size / 4, 1 << 10, 0, "chunked", BodyPath::Chunked, 1},
+        {"read-content", size / 4, 0, 0, "length", BodyPath::WholeContent, 1},
+        {"splice", size, 0, 0, "length", BodyPath::Splice, 1},
+        {"headers-32k", 1 << 10, 0, 32 << 10, "length", BodyPath::SpecifiedLength, 1000},
+    };
+
+    std::vector<bool> tlsModes;
+    if (scheme != "https")
+        tlsModes.push_back(false);
+    if (scheme != "http")
+        tlsModes.push_back(true);
+
+    std::cout << std::left << std::setw(8) << "scheme" << std::setw(16) << "scenario" << std::right
+              << std::setw(10) << "MB" << std::setw(10) << "seconds" << std::setw(10) << "GB/s"
+              << std::setw(14) << "syscalls/MB" << std::setw(12) << "allocs/MB" << std::endl;
+
+    // the sockets log every connection, that would end up in the timings
+    std::streambuf *clogBuffer = std::clog.rdbuf(nullptr);
+
+    try
+    {
+        for (bool tls : tlsModes)
+        {
+            LoopbackServer server(tls);
+
+            for (const Scenario &scenario : scenarios)
+            {
+                Result result = run(server, scenario);
+                double mb = result.bytes / (1024.0 * 1024.0);
+                const char *mode = !tls ? "http" : result.kernelTls ? "ktls" : "https";
+
+                if (result.skipped)
+                {
+                    std::cout << std::left << std::setw(8) << mode << std::setw(16) << scenario.name
+                              << "needs plain TCP or kernel TLS" << std::endl;
+                    continue;
+                }
+
+                std::cout << std::left << std::setw(8) << mode << std::setw(16) << scenario.name
+                          << std::right << std::fixed << std::setprecision(1) << std::setw(10) << mb
+                          << std::setprecision(3) << std::setw(10) << result.seconds
+                          << std::setw(10) << result.bytes / result.seconds / 1e9
+                          << std::setprecision(1) << std::setw(14) << result.counts.syscalls / mb
+                          << std::setw(12) << result.counts.allocations / mb << std::endl;
+            }
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::clog.rdbuf(clogBuffer);
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    std::clog.rdbuf(clogBuffer);
+    return 0;
+}
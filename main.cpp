@@ -1,126 +1,648 @@
+#include "src/cli/cli-options/cli-options.hpp"
+#include "src/downloader/batch-scheduler/batch-scheduler.hpp"
+#include "src/downloader/range-downloader/range-downloader.hpp"
+#include "src/downloader/resume-state/resume-state.hpp"
+#include "src/http/content-decoder/content-decoder.hpp"
 #include "src/http/http-request/http-request.hpp"
 #include "src/http/http-response/http-response.hpp"
 #include "src/http/http-stream-reader/http-stream-reader.hpp"
-#include "src/socket-lib/tcp-socket/tcp-socket.hpp"
-#include "src/socket-lib/ssl-socket/ssl-socket.hpp"
+#include "src/io/download-sink/download-sink.hpp"
+#include "src/io/file-digest/file-digest.hpp"
+#include "src/io/mapped-file/mapped-file.hpp"
+#include "src/io/transfer-pipeline/transfer-pipeline.hpp"
+#include "src/io/uring-engine/uring-engine.hpp"
+#include "src/metrics/progress-display/progress-display.hpp"
+#include "src/metrics/transfer-metrics/transfer-metrics.hpp"
+#include "src/socket-lib/dns-cache/dns-cache.hpp"
+#include "src/socket-lib/rate-limiter/rate-limiter.hpp"
+#include "src/socket-lib/socket-factory/socket-factory.hpp"
+#include "src/socket-lib/tls-context/tls-context.hpp"
 #include "src/utils/utils.hpp"
+#include <fstream>
 #include <iostream>
 #include <string>
 #include <memory>
+#include <optional>
+#include <sstream>
+
+// download the batch list and the given urls on one event loop, returns the no of failed downloads
+static size_t downloadBatch(const CliOptions &options)
+{
+    BatchLimits limits;
+    limits.maxActive = options.maxActive;
+    limits.perHost = options.perHost;
+
+    BatchScheduler scheduler(limits);
+    scheduler.setCompressed(options.compressed);
+
+    if (options.inputFile == "-")
+        scheduler.addFrom(std::cin);
+    else if (!options.inputFile.empty())
+    {
+        std::ifstream input(options.inputFile);
+        if (!input)
+            throw std::runtime_error("cannot open " + options.inputFile);
+        scheduler.addFrom(input);
+    }
+
+    for (const std::string &url : options.urls)
+        scheduler.add(url);
+
+    scheduler.run();
+    scheduler.printSummary(std::clog);
+    return scheduler.failures();
+}
+
+// the checksum list from disk, or fetched when it is a url
+static std::string readChecksumFile(const std::string &location)
+{
+    if (!location.starts_with("http://") && !location.starts_with("https://"))
+    {
+        std::ifstream file(location);
+        if (!file)
+            throw std::runtime_error("cannot open " + location);
+
+        std::stringstream text;
+        text << file.rdbuf();
+        return text.str();
+    }
+
+    ParsedUrl url = parseUrl(location);
+    std::shared_ptr<ISocket> sock = createSocket(url);
+    sock->connectToServer();
+    sock->sendAll(HttpRequest::makeGetRequest(url.host, url.path).toString());
+
+    HttpStreamReader reader(sock);
+    reader.setProgressLogging(false);
+    HttpResponse res;
+    reader.readResponse(res);
+
+    if (res.getStatusCode() != 200)
+        throw std::runtime_error("fetching " + location + " failed with status " + std::to_string(res.getStatusCode()));
+
+    std::string text;
+    if (res.getHeader(Headers::TransferEncoding) == "chunked")
+        reader.readChunkedContent([&text](std::string_view data)
+                                  { text.append(data); });
+    else
+    {
+        std::string contentLength(res.getHeader(Headers::ContentLength));
+        text = reader.readContent(contentLength.empty() ? 0 : std::stoull(contentLength));
+    }
+
+    sock->closeConnection();
+    return text;
+}
+
+// the checksum the saved file is checked against, a value given by the user wins over the server's
+static std::optional<ExpectedDigest> findExpectedDigest(const CliOptions &options, const HttpResponse &res,
+                                                        const std::string &filename, bool isEncoded)
+{
+    std::optional<ExpectedDigest> requested;
+    if (!options.checksum.empty())
+    {
+        requested = parseChecksumOption(options.checksum);
+        if (!requested->hex.empty())
+            return requested;
+    }
+
+    if (!options.checksumFile.empty())
+    {
+        std::optional<ExpectedDigest> listed = digestFromChecksumFile(readChecksumFile(options.checksumFile), filename);
+        if (!listed)
+            throw std::runtime_error("no checksum for " + filename + " in " + options.checksumFile);
+        return listed;
+    }
+
+    // the server's digests are of the encoded body, an algorithm only option keeps its choice
+    std::optional<ExpectedDigest> sent = isEncoded ? std::nullopt : digestFromHeaders(res);
+    if (sent && (!requested || sent->algorithm == requested->algorithm))
+        return sent;
+
+    return requested;
+}
+
+// writes the metrics file when main returns, whichever way the download ended
+struct MetricsWriter
+{
+    const CliOptions &options;
+
+    ~MetricsWriter()
+    {
+        if (options.metricsFile.empty())
+            return;
+
+        try
+        {
+            Metrics::instance().writeTo(options.metricsFile, parseMetricsFormat(options.metricsFormat));
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << e.what() << '\n';
+        }
+    }
+};
 
 int main(int argc, char const *argv[])
 {
-    if (argc < 2)
+    CliOptions options;
+
+    try
+    {
+        options = parseCliOptions(argc, argv);
+    }
+    catch (const std::exception &e)
     {
-        std::cerr << "url required!!";
+        std::cerr << e.what() << '\n';
+        printUsage(argv[0]);
         exit(EXIT_FAILURE);
     }
 
-    std::string actualUrl(argv[1]);
+    MetricsWriter metricsWriter{options};
+
+    // limits from the options, a limit file can change them while downloading
+    RateLimits &limits = RateLimits::instance();
+    limits.setGlobalRate({options.limitRate});
+    limits.setPerHostRate({options.limitPerHost});
+    limits.setDownloadRate({options.limitPerDownload});
+    if (!options.limitFile.empty())
+        limits.watchFile(options.limitFile);
+
+    if (!options.kernelTls)
+        TlsContext::instance().setKernelTls(false);
+
+    DnsCache::instance().setTtl(std::chrono::seconds(options.dnsTtl));
+
+    if (options.urls.size() > 1 || !options.inputFile.empty())
+    {
+        // scripts replacing a shell loop see a failed download in the exit status
+        try
+        {
+            return downloadBatch(options) == 0 ? 0 : EXIT_FAILURE;
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << e.what() << '\n';
+        }
+        return EXIT_FAILURE;
+    }
+
+    std::string actualUrl(options.urls.front());
 
     // extract the host, path and port from the url
     ParsedUrl url = parseUrl(actualUrl);
 
-    // create a HttpRequest object for requesting to server
-    HttpRequest req(
-        "GET", url.path, "HTTP/1.1",
-        {{"Accept", "*/*"},
-         {"Host", url.host},
-         {"User-Agent",
-          "Mozilla/5.0 "
-          "(Windows NT 10.0; Win64; x64) "
-          "AppleWebKit/537.36 "
-          "(KHTML, like Gecko) "
-          "Chrome/91.0.4472.124 "
-          "Safari/537.36"},
-         {"Connection", "close"}});
+    // create a HttpRequest object for requesting to server, compressed bodies only when asked for
+    auto makeRequest = [&]()
+    {
+        HttpRequest request = HttpRequest::makeGetRequest(url.host, url.path);
+        if (options.compressed)
+            request.setHeader({"Accept-Encoding", ACCEPT_ENCODING_VALUE});
+        return request;
+    };
+    HttpRequest req = makeRequest();
 
     // a socket for connecting, sending/receiving data to/from server
     std::shared_ptr<ISocket> sock;
 
+    // a reader helper to read different kinds of data
+    HttpStreamReader reader(nullptr);
+    std::shared_ptr<RateLimiter> limiter = limits.forDownload(url.host);
+    TransferTimer timer(actualUrl);
+
     // for storing the response from server
     HttpResponse res;
 
-    try
+    // send the request over a new connection and read the response headers
+    auto sendRequest = [&]()
     {
-        // create a socket for that host and port
-        if (actualUrl.find("https") != std::string::npos)
-            sock = std::make_shared<SslSocket>(url.host, url.port);
-        else
-            sock = std::make_shared<TcpSocket>(url.host, url.port);
+        if (sock)
+            sock->closeConnection();
 
-        // connect to the server
+        // create a socket for that host and port and connect to the server
+        timer.start();
+        sock = createSocket(url);
         sock->connectToServer();
+        timer.connected();
 
         // send request to server
         sock->sendAll(req.toString());
-
-        // a reader helper to read different kinds of data
-        HttpStreamReader reader(sock);
+        timer.requestSent();
 
         // read headers first
-        std::string headerString = reader.readHeaders();
+        reader = HttpStreamReader(sock);
+        reader.setRateLimiter(limiter);
+        res = HttpResponse();
+        reader.readResponse(res);
+        timer.firstByte();
 
-        std::clog << "received headers: " << headerString << std::endl;
+        std::clog << "received headers: " << res.toString() << std::endl;
+    };
 
-        // set the received headers
-        res.setHeaders(HttpResponse::parseHeaders(headerString));
+    try
+    {
+        sendRequest();
 
         // extract key info from the headers
-        std::string contentLengthString = res.getHeader("Content-Length");
-        std::string contentType = res.getHeader("Content-Type");
-        std::string contentDisposition = res.getHeader("Content-Disposition");
+        std::string contentLengthString(res.getHeader(Headers::ContentLength));
+        std::string contentType(res.getHeader(Headers::ContentType));
+        std::string contentDisposition(res.getHeader(Headers::ContentDisposition));
         size_t contentLength =
-            contentLengthString.empty() ? 0 : std::stoi(contentLengthString);
+            contentLengthString.empty() ? 0 : std::stoull(contentLengthString);
+
+        // Content-Length and ranges count the encoded bytes, not what ends up in the file. without
+        // --compressed nothing was asked for, so a labelled body (a .tar.gz sent as gzip) is saved as is
+        ContentEncoding encoding = options.compressed ? parseContentEncoding(res.getHeader(Headers::ContentEncoding))
+                                                      : ContentEncoding::Identity;
+        bool isEncoded = encoding != ContentEncoding::Identity;
 
         // find the filename with extension
         auto [filename, extension] = getFilenameAndExtension(contentDisposition, contentType, actualUrl);
         std::clog << "filename " << filename << extension << std::endl;
 
-        long long fileSize = getFileSizeIfPresent("downloads/" + filename + extension);
+        // the file is downloaded into a .part file which is renamed on completion
+        std::string filepath = "downloads/" + filename + extension;
+        std::string partPath = filepath + ".part";
 
-        if (fileSize != -1)
+        long long fileSize = getFileSizeIfPresent(filepath);
+
+        // when file is already downloaded then skip downloading, a checksum the user
+        // asked for has to match as well since the size alone proves nothing
+        bool alreadyDownloaded = !isEncoded && contentLength > 0 && fileSize == (long long)contentLength;
+        if (alreadyDownloaded && (!options.checksum.empty() || !options.checksumFile.empty()))
         {
-            bool isFileDownloaded = fileSize == (long long)contentLength;
+            std::optional<ExpectedDigest> expected = findExpectedDigest(options, res, filename + extension, isEncoded);
+            if (expected && !expected->hex.empty())
+            {
+                FileDigest existing(expected->algorithm);
+                existing.updateFromFile(filepath, fileSize);
+                alreadyDownloaded = existing.finish() == expected->hex;
+                if (!alreadyDownloaded)
+                    std::clog << "existing " << filepath << " doesnt match the checksum, downloading again" << std::endl;
+            }
+        }
+
+        if (alreadyDownloaded)
+        {
+            std::clog << "file already downloaded" << std::endl;
+            sock->closeConnection();
+            return 0;
+        }
+
+        // offset in the file from where the body of the response starts
+        size_t startOffset = 0;
 
-            std::clog << (long long)contentLength - fileSize
-                      << " bytes remaining to download from "
-                      << contentLength << " bytes" << std::endl;
+        long long partSize = getFileSizeIfPresent(partPath);
+        std::optional<ResumeState> savedState = ResumeState::load(partPath);
 
-            // when file is already downloaded then skip downloading
-            if (isFileDownloaded)
+        // resume only when the partial file belongs to the same version of the resource
+        if (!isEncoded && partSize > 0 && savedState && savedState->matches(ResumeState::fromResponse(res)) &&
+            !savedState->ifRangeValue().empty())
+        {
+            std::clog << "resuming download from " << partSize << " bytes" << std::endl;
+
+            req.setHeader({"Range", "bytes=" + std::to_string(partSize) + "-"});
+            req.setHeader({"If-Range", savedState->ifRangeValue()});
+            sendRequest();
+
+            ContentRange contentRange = parseContentRange(std::string(res.getHeader(Headers::ContentRange)));
+
+            // server is sending the rest of the file
+            if (res.getStatusCode() == 206)
+            {
+                if (contentRange.start != partSize)
+                    throw std::runtime_error("server resumed from " + std::to_string(contentRange.start) +
+                                             " instead of " + std::to_string(partSize));
+
+                startOffset = partSize;
+            }
+
+            // nothing is left after our offset
+            else if (res.getStatusCode() == 416 && contentRange.total == partSize)
             {
+                std::clog << "file already downloaded" << std::endl;
                 sock->closeConnection();
+                std::filesystem::rename(partPath, filepath);
+                ResumeState::discard(partPath);
                 return 0;
             }
+
+            // our offset doesnt fit the resource anymore so download it again
+            else if (res.getStatusCode() == 416)
+            {
+                std::clog << "partial file doesnt match the resource, downloading again" << std::endl;
+                ResumeState::discard(partPath);
+                req = makeRequest();
+                sendRequest();
+            }
+
+            // any other status is handled as a fresh response below
+            else
+                std::clog << "server sent the whole file, downloading again" << std::endl;
+
+            contentLengthString = res.getHeader(Headers::ContentLength);
+            contentLength = contentLengthString.empty() ? 0 : std::stoull(contentLengthString);
+            encoding = options.compressed ? parseContentEncoding(res.getHeader(Headers::ContentEncoding))
+                                          : ContentEncoding::Identity;
+            isEncoded = encoding != ContentEncoding::Identity;
+
+            if (startOffset > 0 && isEncoded)
+                throw std::runtime_error("server sent the resumed range compressed");
         }
-        // handle chunked data(will be saved to file)
-        if (res.getHeader("Transfer-Encoding") == "chunked")
+
+        if (res.getStatusCode() != 200 && res.getStatusCode() != 206)
+            throw std::runtime_error("request failed with status " + std::to_string(res.getStatusCode()));
+
+        // a fresh download starts from an empty file with the current validators, a
+        // decompressed file cant be resumed as its size says nothing about the encoded offset
+        if (startOffset == 0)
+        {
+            ResumeState::discard(partPath);
+            if (!isEncoded)
+                ResumeState::fromResponse(res).save(partPath);
+        }
+
+        bool isChunked = res.getHeader(Headers::TransferEncoding) == "chunked";
+
+        std::optional<ExpectedDigest> expectedDigest = findExpectedDigest(options, res, filename + extension, isEncoded);
+        if (expectedDigest && !expectedDigest->hex.empty())
+            std::clog << "expecting " << digestName(expectedDigest->algorithm) << " " << expectedDigest->hex
+                      << " from the " << expectedDigest->source << std::endl;
+
+        // split the download over parallel range requests when the server allows it
+        if (options.connections > 1 && !isChunked && !isEncoded && contentLength > 0 &&
+            res.getStatusCode() == 200 && res.getHeader(Headers::AcceptRanges) == "bytes")
         {
-            std::clog << "chunked transfer found" << std::endl;
-            reader.readChunkedContent([filename, extension](const std::string &data)
-                                      { saveToFile("downloads/" + filename + extension, data); });
+            // this response only served as a probe
+            sock->closeConnection();
+
+            RangeDownloader downloader(url, filepath, contentLength, options.connections, options.queueDepth);
+            if (expectedDigest)
+                downloader.setExpectedDigest(*expectedDigest);
+            downloader.download();
+            return 0;
         }
 
         // log text like content
-        else if (contentType.starts_with("text/") || contentType.starts_with("application/json"))
+        if (!isChunked && (contentType.starts_with("text/") || contentType.starts_with("application/json")))
+        {
+            ResumeState::discard(partPath);
+
+            std::string text;
+            ContentDecoder decoder(encoding);
+            decoder.decode(reader.readContent(contentLength), [&text](std::string_view data)
+                           { text.append(data); });
+            decoder.finish();
+            timer.finished(decoder.getCompressedBytes(), false);
+
+            std::clog << text << std::endl;
+            sock->closeConnection();
+            return 0;
+        }
+
+        // the bytes kept from an earlier run are hashed before the new ones
+        std::optional<FileDigest> digest;
+        if (expectedDigest)
         {
-            std::clog << reader.readContent(contentLength) << std::endl;
+            digest.emplace(expectedDigest->algorithm);
+            if (startOffset > 0)
+                digest->updateFromFile(partPath, startOffset);
         }
 
-        // handle receiving large data(will be saved to file)
+        // the file stays open for the whole download, writes continue after the resumed bytes
+        DownloadSink sink(partPath, startOffset);
+
+        bool reserved = false;
+        if (contentLength > 0 && !isEncoded)
+            reserved = sink.preallocate(startOffset + contentLength);
+
+        if (options.directIo && !isEncoded && contentLength >= DIRECT_IO_MIN_SIZE && !sink.enableDirectIo())
+            std::clog << "O_DIRECT not supported for " << partPath << ", using buffered writes" << std::endl;
+
+        // with kernel TLS a control record like close_notify fails a plain read with EIO, so
+        // only a body of known length is read from the fd of a TLS connection
+        bool rawBody = sock->getRawFd() >= 0 && (contentLength > 0 || url.scheme != "https");
+
+        // io_uring moves plain bodies from the socket to the file without blocking calls
+        bool useIoUring = options.ioUring && !isChunked && !isEncoded && rawBody && !sink.isDirectIo();
+        if (options.ioUring && !useIoUring)
+            std::clog << "io_uring only handles plain Content-Length bodies, using the regular path" << std::endl;
+        else if (useIoUring && digest)
+        {
+            std::clog << "io_uring bypasses the checksum, using the regular path" << std::endl;
+            useIoUring = false;
+        }
+        else if (useIoUring && limits.isLimited(url.host))
+        {
+            std::clog << "io_uring cant apply rate limits, using the regular path" << std::endl;
+            useIoUring = false;
+        }
+        else if (useIoUring && !UringEngine::isAvailable())
+        {
+            std::clog << "io_uring not available, using the regular path" << std::endl;
+            useIoUring = false;
+        }
+
+        // registering the buffers and the file can still fail, e.g. under a low RLIMIT_MEMLOCK,
+        // so the engine is set up before any body byte is taken from the reader
+        std::optional<UringEngine> engine;
+        if (useIoUring)
+        {
+            try
+            {
+                engine.emplace(sock->getRawFd(), sink.getFd(), options.queueDepth);
+            }
+            catch (const std::exception &e)
+            {
+                std::clog << e.what() << ", using the regular path" << std::endl;
+                useIoUring = false;
+            }
+        }
+
+        // the body is received straight into the mapped file instead of going through buffers
+        std::optional<MappedFile> mapped;
+        ResumeState validators = ResumeState::fromResponse(res);
+        if (options.mmap && !useIoUring)
+        {
+            if (isChunked || isEncoded || contentLength == 0 || sink.isDirectIo())
+                std::clog << "mmap only handles plain Content-Length bodies without O_DIRECT, using the regular path" << std::endl;
+            // pages without reserved blocks fault with SIGBUS when the disk fills up
+            else if (!reserved)
+                std::clog << "the filesystem cant reserve the file for mmap, using the regular path" << std::endl;
+            else
+            {
+                // a mapped file has its full size till it is closed, if the process dies
+                // meanwhile the file must not look complete to the next run
+                ResumeState::discardState(partPath);
+                try
+                {
+                    mapped.emplace(sink.getFd(), startOffset, startOffset + contentLength);
+                }
+                catch (const std::exception &e)
+                {
+                    validators.save(partPath);
+                    std::clog << e.what() << ", using the regular path" << std::endl;
+                }
+            }
+        }
+
+        // splice moves plain bodies from the socket to the file inside the kernel
+        bool useSplice = options.splice && !useIoUring && !mapped;
+        if (useSplice && (isChunked || isEncoded || !rawBody || sink.isDirectIo()))
+        {
+            std::clog << "splice only handles plain HTTP or kernel TLS Content-Length bodies, using the regular path" << std::endl;
+            useSplice = false;
+        }
+        else if (useSplice && digest)
+        {
+            std::clog << "splice bypasses the checksum, using the regular path" << std::endl;
+            useSplice = false;
+        }
+
+        // sits between the reader and the file, passes identity bodies through unchanged
+        ContentDecoder decoder(encoding);
+
+        if (useIoUring || useSplice)
+        {
+            // bytes received along with the headers are written first
+            std::string_view buffered = reader.getBuffered();
+            if (contentLength > 0)
+                buffered = buffered.substr(0, contentLength);
+            sink.write(buffered.data(), buffered.size());
+            reader.consume(buffered.size());
+
+            size_t remaining = contentLength > 0 ? contentLength - buffered.size() : 0;
+            if ((contentLength == 0 || remaining > 0) && useIoUring)
+            {
+                sink.advance(engine->transfer(sink.getOffset(), remaining));
+            }
+            else if (contentLength == 0 || remaining > 0)
+            {
+                uint64_t receivedBefore = Metrics::instance().get(Counter::BytesReceived) - buffered.size();
+                ProgressDisplay progress([receivedBefore]()
+                                         { return Metrics::instance().get(Counter::BytesReceived) - receivedBefore; },
+                                         contentLength);
+                sink.advance(reader.spliceContent(sink.getFd(), sink.getOffset(), remaining));
+            }
+
+            std::clog << "received " << sink.getOffset() - startOffset << " bytes with "
+                      << (useIoUring ? "io_uring" : "splice") << std::endl;
+        }
+        else if (mapped)
+        {
+            uint64_t receivedBefore = Metrics::instance().get(Counter::BytesReceived) - reader.getBuffered().size();
+            ProgressDisplay progress([receivedBefore]()
+                                     { return Metrics::instance().get(Counter::BytesReceived) - receivedBefore; },
+                                     contentLength);
+
+            // every piece lands at its place in the file, the callback only hashes and commits it
+            size_t received = 0;
+            try
+            {
+                received = reader.readContentInto(mapped->remaining(), [&](std::string_view data)
+                                                  {
+                                                      if (digest)
+                                                          digest->update(data);
+                                                      mapped->commit(data.size()); });
+            }
+            catch (const std::exception &)
+            {
+                // cut back to what arrived the file can be resumed again
+                mapped->close();
+                validators.save(partPath);
+                throw;
+            }
+
+            progress.stop();
+            mapped->close();
+            validators.save(partPath);
+            sink.advance(received);
+
+            std::clog << "received " << received << " bytes into the mapped file" << std::endl;
+        }
         else
         {
-            reader.readSpecifiedChunkedContent(contentLength, [filename, extension](const std::string &data)
-                                               { saveToFile("downloads/" + filename + extension, data); });
+            // a writer thread drains the received data to the file so disk stalls dont stop the socket reads
+            TransferPipeline pipeline(sink, options.queueDepth);
+
+            // the status line counts the body bytes from the receive counter, including those already buffered
+            uint64_t receivedBefore = Metrics::instance().get(Counter::BytesReceived) - reader.getBuffered().size();
+            ProgressDisplay progress([receivedBefore]()
+                                     { return Metrics::instance().get(Counter::BytesReceived) - receivedBefore; },
+                                     isChunked ? 0 : contentLength);
+            reader.setProgressLogging(false);
+            auto write = [&pipeline, &digest](std::string_view data)
+            {
+                if (digest)
+                    digest->update(data);
+                pipeline.write(data.data(), data.size());
+            };
+
+            // handle chunked data(will be saved to file)
+            if (isChunked)
+            {
+                std::clog << "chunked transfer found" << std::endl;
+                reader.readChunkedContent([&](std::string_view data)
+                                          { decoder.decode(data, write); });
+            }
+
+            // handle receiving large data(will be saved to file)
+            else
+            {
+                reader.readSpecifiedChunkedContent(contentLength, [&](const std::string &data)
+                                                   { decoder.decode(data, write); });
+            }
+
+            progress.stop();
+            pipeline.finish();
+            pipeline.logStats();
+
+            // a cut short body fails the size check below, a complete one has to end the stream
+            if (isEncoded && (isChunked || contentLength == 0 || decoder.getCompressedBytes() == contentLength))
+                decoder.finish();
+
+            if (isEncoded)
+                std::clog << "received " << decoder.getCompressedBytes() << " compressed bytes, "
+                          << decoder.getDecompressedBytes() << " after decoding" << std::endl;
         }
 
-        // finally close the connection to server
+        // finally close the connection to server and the file
         sock->closeConnection();
+        sink.close();
+
+        // keep the partial file for resuming when the body got cut short
+        size_t bodyReceived = useIoUring || useSplice || mapped ? sink.getOffset() - startOffset : decoder.getCompressedBytes();
+        timer.finished(bodyReceived, !isChunked && contentLength > 0 && bodyReceived != contentLength);
+
+        if (!isChunked && contentLength > 0 && bodyReceived != contentLength)
+            throw std::runtime_error("download incomplete, " + std::to_string(startOffset + bodyReceived) + " of " +
+                                     std::to_string(startOffset + contentLength) + " bytes received");
+
+        // a file that doesnt match is useless for resuming as well
+        if (digest)
+        {
+            std::string actual = digest->finish();
+            std::clog << digestName(expectedDigest->algorithm) << " " << actual << std::endl;
+
+            try
+            {
+                verifyDigest(*expectedDigest, actual);
+            }
+            catch (const std::exception &)
+            {
+                ResumeState::discard(partPath);
+                throw;
+            }
+        }
+
+        std::filesystem::rename(partPath, filepath);
+        ResumeState::discard(partPath);
     }
     catch (const std::exception &e)
     {
+        // a failed download, a checksum mismatch included, has to show in the exit status
         std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
     }
 
     return 0;
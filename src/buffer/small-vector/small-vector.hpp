@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+// a vector keeping its first N items inside the object, only a longer list
+// moves to the heap. items are plain structs copied with memcpy.
+template <typename T, size_t N>
+class SmallVector
+{
+    static_assert(std::is_trivially_copyable_v<T>, "SmallVector only holds trivially copyable items");
+
+    T inlineItems[N];
+    std::unique_ptr<T[]> heapItems;
+    T *items;
+    size_t count;
+    size_t capacity;
+
+public:
+    SmallVector() : heapItems(nullptr), items(inlineItems), count(0), capacity(N) {}
+
+    SmallVector(const SmallVector &other) : SmallVector()
+    {
+        *this = other;
+    }
+
+    SmallVector &operator=(const SmallVector &other)
+    {
+        if (this == &other)
+            return *this;
+
+        count = 0;
+        reserve(other.count);
+        if (other.count > 0)
+            memcpy(items, other.items, other.count * sizeof(T));
+        count = other.count;
+        return *this;
+    }
+
+    // inline items cant be stolen so a move copies them
+    SmallVector(SmallVector &&other) noexcept : SmallVector()
+    {
+        *this = std::move(other);
+    }
+
+    SmallVector &operator=(SmallVector &&other) noexcept
+    {
+        if (this == &other)
+            return *this;
+
+        if (other.heapItems)
+        {
+            heapItems = std::move(other.heapItems);
+            items = heapItems.get();
+            capacity = other.capacity;
+        }
+        else
+        {
+            heapItems.reset();
+            items = inlineItems;
+            capacity = N;
+            if (other.count > 0)
+                memcpy(items, other.items, other.count * sizeof(T));
+        }
+
+        count = other.count;
+        other.items = other.inlineItems;
+        other.capacity = N;
+        other.count = 0;
+        return *this;
+    }
+
+    void push_back(const T &item)
+    {
+        if (count == capacity)
+            reserve(capacity * 2);
+        items[count++] = item;
+    }
+
+    // remove the item at index, later items move one place up
+    void erase(size_t index)
+    {
+        memmove(items + index, items + index + 1, (count - index - 1) * sizeof(T));
+        count--;
+    }
+
+    void reserve(size_t wanted)
+    {
+        if (wanted <= capacity)
+            return;
+
+        std::unique_ptr<T[]> grown(new T[wanted]);
+        if (count > 0)
+            memcpy(grown.get(), items, count * sizeof(T));
+
+        heapItems = std::move(grown);
+        items = heapItems.get();
+        capacity = wanted;
+    }
+
+    void clear() { count = 0; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    T &operator[](size_t index) { return items[index]; }
+    const T &operator[](size_t index) const { return items[index]; }
+    T &back() { return items[count - 1]; }
+
+    T *begin() { return items; }
+    T *end() { return items + count; }
+    const T *begin() const { return items; }
+    const T *end() const { return items + count; }
+};
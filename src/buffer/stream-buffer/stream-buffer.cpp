@@ -0,0 +1,91 @@
+#include "stream-buffer.hpp"
+
+// create an empty buffer of the given capacity
+StreamBuffer::StreamBuffer(size_t cap)
+    : data(std::make_unique<char[]>(cap)), capacity(cap), readPos(0), writePos(0) {}
+
+size_t StreamBuffer::size() const
+{
+    return writePos - readPos;
+}
+
+bool StreamBuffer::empty() const
+{
+    return readPos == writePos;
+}
+
+std::string_view StreamBuffer::readable() const
+{
+    return std::string_view(data.get() + readPos, size());
+}
+
+// only moves the read cursor, rewinds both cursors when everything is read
+void StreamBuffer::consume(size_t n)
+{
+    readPos += std::min(n, size());
+
+    if (readPos == writePos)
+        readPos = writePos = 0;
+}
+
+char *StreamBuffer::writePtr()
+{
+    return data.get() + writePos;
+}
+
+// move the unread bytes to the front only when the tail is full
+size_t StreamBuffer::writable()
+{
+    if (writePos == capacity && readPos > 0)
+        compact();
+
+    return capacity - writePos;
+}
+
+void StreamBuffer::commit(size_t n)
+{
+    writePos += std::min(n, capacity - writePos);
+}
+
+// copy the bytes after the unread ones, grows when they dont fit
+void StreamBuffer::append(std::string_view bytes)
+{
+    reserve(bytes.size());
+    std::memcpy(data.get() + writePos, bytes.data(), bytes.size());
+    writePos += bytes.size();
+}
+
+// make room for n more bytes, compacting first and growing only when still short
+void StreamBuffer::reserve(size_t n)
+{
+    if (capacity - writePos >= n)
+        return;
+
+    compact();
+    if (capacity - writePos >= n)
+        return;
+
+    size_t newCapacity = std::max(capacity * 2, writePos + n);
+    std::unique_ptr<char[]> grown = std::make_unique<char[]>(newCapacity);
+    std::memcpy(grown.get(), data.get(), writePos);
+
+    data = std::move(grown);
+    capacity = newCapacity;
+}
+
+void StreamBuffer::clear()
+{
+    readPos = writePos = 0;
+}
+
+// move the unread bytes to the start of the slab
+void StreamBuffer::compact()
+{
+    if (readPos == 0)
+        return;
+
+    size_t unread = size();
+    std::memmove(data.get(), data.get() + readPos, unread);
+    readPos = 0;
+    writePos = unread;
+}
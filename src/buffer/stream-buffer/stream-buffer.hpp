@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#define STREAM_BUFFER_CAPACITY 65536 // 64KB ka buffer socket se padhne ke liye
+
+// a slab of bytes with a read and a write cursor, bytes between the cursors
+// are the unread ones. consuming only moves the read cursor, the unread bytes
+// are moved back to the front only when there is no space left after them.
+class StreamBuffer
+{
+    std::unique_ptr<char[]> data;
+    size_t capacity;
+    size_t readPos;  // first unread byte
+    size_t writePos; // first free byte
+
+public:
+    explicit StreamBuffer(size_t capacity = STREAM_BUFFER_CAPACITY);
+
+    size_t size() const;             // no of unread bytes
+    bool empty() const;
+    std::string_view readable() const; // unread bytes in one contiguous view
+    void consume(size_t n);          // mark the first n unread bytes as read
+
+    char *writePtr();                // where the next received bytes should go
+    size_t writable();               // free space after the write cursor, compacts when full
+    void commit(size_t n);           // mark n bytes after the write cursor as written
+    void append(std::string_view bytes);
+    void reserve(size_t n);          // make sure n bytes can be written without compaction
+
+    void clear();
+
+private:
+    void compact();
+};
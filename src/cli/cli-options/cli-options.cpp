@@ -0,0 +1,152 @@
+#include "cli-options.hpp"
+#include "../../io/file-digest/file-digest.hpp"
+#include "../../metrics/transfer-metrics/transfer-metrics.hpp"
+#include "../../socket-lib/rate-limiter/rate-limiter.hpp"
+
+// take the value that follows an option, fails when it is missing
+static std::string takeValue(int &i, int argc, char const *argv[])
+{
+    if (i + 1 >= argc)
+        throw std::runtime_error(std::string("missing value for ") + argv[i]);
+
+    return argv[++i];
+}
+
+// parse a strictly positive integer option value
+static int toPositiveInt(const std::string &option, const std::string &value)
+{
+    size_t consumed = 0;
+    int number = 0;
+
+    try
+    {
+        number = std::stoi(value, &consumed);
+    }
+    catch (const std::exception &)
+    {
+        consumed = 0;
+    }
+
+    if (consumed != value.size() || number <= 0)
+        throw std::runtime_error("invalid value '" + value + "' for " + option);
+
+    return number;
+}
+
+// parse the command line arguments into options
+CliOptions parseCliOptions(int argc, char const *argv[])
+{
+    CliOptions options;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg(argv[i]);
+
+        if (arg == "-c" || arg == "--connections")
+            options.connections = toPositiveInt(arg, takeValue(i, argc, argv));
+
+        else if (arg == "--direct-io")
+            options.directIo = true;
+
+        else if (arg == "--io-uring")
+            options.ioUring = true;
+
+        else if (arg == "--mmap")
+            options.mmap = true;
+
+        else if (arg == "--splice")
+            options.splice = true;
+
+        else if (arg == "--no-ktls")
+            options.kernelTls = false;
+
+        else if (arg == "--dns-ttl")
+            options.dnsTtl = toPositiveInt(arg, takeValue(i, argc, argv));
+
+        else if (arg == "--queue-depth")
+            options.queueDepth = toPositiveInt(arg, takeValue(i, argc, argv));
+
+        else if (arg == "-i" || arg == "--input")
+            options.inputFile = takeValue(i, argc, argv);
+
+        else if (arg == "--max-active")
+            options.maxActive = toPositiveInt(arg, takeValue(i, argc, argv));
+
+        else if (arg == "--per-host")
+            options.perHost = toPositiveInt(arg, takeValue(i, argc, argv));
+
+        else if (arg == "--compressed")
+            options.compressed = true;
+
+        else if (arg == "--limit-rate")
+            options.limitRate = parseRate(takeValue(i, argc, argv));
+
+        else if (arg == "--limit-per-host")
+            options.limitPerHost = parseRate(takeValue(i, argc, argv));
+
+        else if (arg == "--limit-per-download")
+            options.limitPerDownload = parseRate(takeValue(i, argc, argv));
+
+        else if (arg == "--limit-file")
+            options.limitFile = takeValue(i, argc, argv);
+
+        else if (arg == "--metrics")
+            options.metricsFile = takeValue(i, argc, argv);
+
+        else if (arg == "--metrics-format")
+        {
+            options.metricsFormat = takeValue(i, argc, argv);
+            parseMetricsFormat(options.metricsFormat);
+        }
+
+        else if (arg == "--checksum")
+        {
+            options.checksum = takeValue(i, argc, argv);
+            parseChecksumOption(options.checksum);
+        }
+
+        else if (arg == "--checksum-file")
+            options.checksumFile = takeValue(i, argc, argv);
+
+        else if (arg.starts_with("-"))
+            throw std::runtime_error("unknown option " + arg);
+
+        else
+            options.urls.push_back(arg);
+    }
+
+    if (options.urls.empty() && options.inputFile.empty())
+        throw std::runtime_error("url required!!");
+
+    return options;
+}
+
+// show how the program should be invoked
+void printUsage(const std::string &program)
+{
+    std::cerr << "usage: " << program << " [options] <url> [more urls...]\n"
+              << "  -c, --connections <n>   download using n parallel range requests\n"
+              << "  --direct-io             bypass the page cache when writing files of 64MB or more\n"
+              << "  --queue-depth <n>       received buffers allowed to wait for the disk (default 8)\n"
+              << "  --io-uring              receive and write plain HTTP bodies with io_uring\n"
+              << "  --mmap                  receive Content-Length bodies straight into the memory mapped file\n"
+              << "  --splice                move plain HTTP bodies from the socket to the file with splice()\n"
+              << "  --no-ktls               decrypt TLS in user space even when the kernel could do it\n"
+              << "  --dns-ttl <seconds>     how long resolved addresses are reused (default 60)\n"
+              << "  -i, --input <file>      download the urls listed in file (- for stdin), one per line\n"
+              << "                          optionally followed by a priority: high, normal or low\n"
+              << "  --max-active <n>        downloads of a batch running at the same time (default 8)\n"
+              << "  --per-host <n>          downloads of a batch running against one host (default 4)\n"
+              << "  --compressed            ask for gzip, deflate or br bodies and decompress them while saving\n"
+              << "  --limit-rate <rate>     bytes per second for all downloads together, like 500K, 10M or 1G\n"
+              << "  --limit-per-host <rate> bytes per second for the downloads from one host\n"
+              << "  --limit-per-download <rate>\n"
+              << "                          bytes per second for every single download\n"
+              << "  --limit-file <file>     rate limits that are read again whenever the file changes\n"
+              << "  --metrics <file>        write timings, counters and histograms to file at the end (- for stdout)\n"
+              << "  --metrics-format <fmt>  json (default) or prometheus\n"
+              << "  --checksum <algo>[:<hex>]\n"
+              << "                          hash the file while saving it with sha256, sha1, md5 or crc32c\n"
+              << "                          and fail the download when it doesnt match hex\n"
+              << "  --checksum-file <file>  take the expected checksum from a sha256sum style list, a path or a url\n";
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <stdexcept>
+#include <iostream>
+#include <vector>
+
+struct CliOptions
+{
+    std::vector<std::string> urls; // more than one url are downloaded together on one event loop
+    int connections = 1;   // no of parallel range connections for a download
+    bool directIo = false; // write large files with O_DIRECT
+    int queueDepth = 8;    // received buffers allowed to wait for the disk
+    bool ioUring = false;  // move plain HTTP bodies to the file with io_uring
+    bool mmap = false;     // receive Content-Length bodies straight into the mapped file
+    bool splice = false;   // move plain HTTP bodies to the file with splice(), never copying them to user space
+    bool kernelTls = true; // let the kernel decrypt TLS records when it supports it
+    int dnsTtl = 60;       // seconds a resolved address is reused
+    std::string inputFile; // batch list of urls, - for stdin
+    int maxActive = 8;     // downloads of a batch running at the same time
+    int perHost = 4;       // downloads of a batch running against one host
+    bool compressed = false; // ask for gzip/deflate/br bodies and decompress them while saving
+    size_t limitRate = 0;        // bytes per second for all downloads together, 0 for no limit
+    size_t limitPerHost = 0;     // bytes per second for the downloads from one host
+    size_t limitPerDownload = 0; // bytes per second for every single download
+    std::string limitFile;       // limits read again whenever the file changes
+    std::string metricsFile;     // transfer metrics are written here at the end, - for stdout
+    std::string metricsFormat = "json"; // json or prometheus
+    std::string checksum;        // <algorithm>[:<hex>], the file is hashed while it is written
+    std::string checksumFile;    // sha256sum style list, a local file or a url
+};
+
+CliOptions parseCliOptions(int argc, char const *argv[]);
+
+void printUsage(const std::string &program);
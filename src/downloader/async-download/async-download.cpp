@@ -0,0 +1,380 @@
+#include "async-download.hpp"
+
+AsyncDownload::AsyncDownload(const std::string &url, Reactor &reactor, ConnectionPool *pool)
+    : url(url), parsedUrl(parseUrl(url)), reactor(reactor), pool(pool), sock(nullptr), reusedConnection(false),
+      responseStarted(false), retried(false),
+      bodyDelimited(false), reader(nullptr), limiter(RateLimits::instance().forDownload(parsedUrl.host)), timerFd(-1),
+      timer(url),
+      request(HttpRequest::makeGetRequest(parsedUrl.host, parsedUrl.path, pool != nullptr).toString()), requestSent(0),
+      res(), sink(nullptr), compressed(false), decoder(nullptr), digest(nullptr),
+      expectedDigest(), filepath(""), partPath(""), state(DownloadState::Connecting), error(""),
+      received(0), contentLength(0), watchedFd(-1), watchedEvents(0), onFinish(nullptr),
+      onResponse(nullptr), claimPath(nullptr) {}
+
+AsyncDownload::~AsyncDownload()
+{
+    unwatch();
+    if (sock)
+        sock->closeConnection();
+    if (timerFd >= 0)
+        close(timerFd);
+}
+
+// create the non-blocking socket and take the first steps right away
+void AsyncDownload::start(std::function<void(AsyncDownload &)> finished)
+{
+    this->onFinish = std::move(finished);
+    timer.start();
+
+    try
+    {
+        connect();
+    }
+    catch (const std::exception &e)
+    {
+        finish(DownloadState::Failed, e.what());
+        return;
+    }
+
+    advance();
+}
+
+// take an idle connection of the pool or start a new one
+void AsyncDownload::connect()
+{
+    sock = pool ? pool->acquire(parsedUrl) : nullptr;
+    reusedConnection = sock != nullptr;
+
+    if (reusedConnection)
+    {
+        state = DownloadState::SendingRequest;
+        timer.connected();
+    }
+    else
+    {
+        sock = pool ? pool->create(parsedUrl) : createSocket(parsedUrl);
+        state = DownloadState::Connecting;
+    }
+
+    sock->setNonBlocking(true);
+    requestSent = 0;
+    responseStarted = false;
+    reader = HttpStreamReader(sock);
+    reader.setProgressLogging(false);
+    reader.setRateLimiter(limiter);
+}
+
+// the server may close an idle connection just as we reuse it, the request is
+// sent again once on a new connection when sending or receiving failed before
+// any response byte came. a status or parse error is the server's real answer
+bool AsyncDownload::retryOnNewConnection()
+{
+    if (!reusedConnection || retried)
+        return false;
+
+    bool nothingReceived = state == DownloadState::ReadingHeaders && !responseStarted && reader.getBuffered().empty();
+    if (state != DownloadState::SendingRequest && !nothingReceived)
+        return false;
+
+    retried = true;
+    unwatch();
+    sock->closeConnection();
+    connect();
+    return true;
+}
+
+// run the state machine until the socket has to wait
+void AsyncDownload::advance()
+{
+    try
+    {
+        while (true)
+        {
+            IoStatus status = IoStatus::Done;
+
+            switch (state)
+            {
+            case DownloadState::Connecting:
+                // the connector closes the fds it hands out for waiting (a refused address, the race
+                // fd once connected) and a new one often gets the same number back. epoll forgets
+                // a closed fd, so it has to leave the reactor first and is added again in watch
+                unwatch();
+                status = sock->connectStep();
+                if (status == IoStatus::Done)
+                {
+                    state = DownloadState::SendingRequest;
+                    timer.connected();
+                }
+                break;
+
+            case DownloadState::SendingRequest:
+            {
+                size_t sent = 0;
+                status = sock->trySend(std::string_view(request).substr(requestSent), sent);
+                requestSent += sent;
+                if (requestSent == request.size())
+                {
+                    timer.requestSent();
+                    status = IoStatus::Done;
+                    state = DownloadState::ReadingHeaders;
+                }
+                break;
+            }
+
+            case DownloadState::ReadingHeaders:
+            {
+                status = reader.tryReadResponse(res);
+                responseStarted = responseStarted || status == IoStatus::Done || !reader.getBuffered().empty();
+                if (status == IoStatus::Done)
+                {
+                    timer.firstByte();
+                    if (!onHeaders())
+                    {
+                        finish(DownloadState::Cancelled);
+                        return;
+                    }
+                    state = DownloadState::ReadingBody;
+                }
+                break;
+            }
+
+            case DownloadState::ReadingBody:
+                status = reader.tryReadBody([this](std::string_view data)
+                                            {
+                                                received += data.size();
+                                                decoder->decode(data, [this](std::string_view output)
+                                                                {
+                                                                    if (digest)
+                                                                        digest->update(output);
+                                                                    sink->write(output.data(), output.size()); }); });
+                if (status == IoStatus::Done)
+                {
+                    if (contentLength > 0 && received != contentLength)
+                        throw std::runtime_error("body ended after " + std::to_string(received) + " of " +
+                                                 std::to_string(contentLength) + " bytes");
+
+                    decoder->finish();
+                    if (digest)
+                        verifyDigest(*expectedDigest, digest->finish());
+                    sink->close();
+                    std::filesystem::rename(partPath, filepath);
+                    finish(DownloadState::Done);
+                    return;
+                }
+                break;
+
+            default:
+                return;
+            }
+
+            if (status != IoStatus::Done)
+            {
+                watch(status);
+                return;
+            }
+        }
+    }
+    catch (const std::exception &e)
+    {
+        if (retryOnNewConnection())
+        {
+            advance();
+            return;
+        }
+        finish(DownloadState::Failed, e.what());
+    }
+}
+
+void AsyncDownload::setResponseHandler(std::function<bool(AsyncDownload &)> handler)
+{
+    this->onResponse = std::move(handler);
+}
+
+void AsyncDownload::setPathClaimer(std::function<std::string(const std::string &, const std::string &)> claimer)
+{
+    this->claimPath = std::move(claimer);
+}
+
+void AsyncDownload::setCompressed(bool enabled)
+{
+    compressed = enabled;
+    HttpRequest req = HttpRequest::makeGetRequest(parsedUrl.host, parsedUrl.path, pool != nullptr);
+    if (enabled)
+        req.setHeader({"Accept-Encoding", ACCEPT_ENCODING_VALUE});
+    request = req.toString();
+}
+
+// check the response and open the output file, false when the download got cancelled
+bool AsyncDownload::onHeaders()
+{
+    if (res.getStatusCode() != 200)
+        throw std::runtime_error("request failed with status " + std::to_string(res.getStatusCode()));
+
+    std::string contentLengthString(res.getHeader(Headers::ContentLength));
+    contentLength = contentLengthString.empty() ? 0 : std::stoull(contentLengthString);
+
+    if (onResponse && !onResponse(*this))
+        return false;
+
+    auto [filename, extension] =
+        getFilenameAndExtension(std::string(res.getHeader(Headers::ContentDisposition)),
+                                std::string(res.getHeader(Headers::ContentType)), url);
+    filepath = claimPath ? claimPath(filename, extension) : "downloads/" + filename + extension;
+    partPath = filepath + ".part";
+
+    // the length of an encoded body says nothing about the file size, without Accept-Encoding
+    // the body is saved as the server labelled it
+    decoder = std::make_unique<ContentDecoder>(compressed ? parseContentEncoding(res.getHeader(Headers::ContentEncoding))
+                                                          : ContentEncoding::Identity);
+
+    // a batch download always starts fresh, a longer leftover part file would keep its stale tail
+    ResumeState::discard(partPath);
+    sink = std::make_unique<DownloadSink>(partPath);
+    if (contentLength > 0 && decoder->getEncoding() == ContentEncoding::Identity)
+        sink->preallocate(contentLength);
+
+    // a digest sent by the server is checked on the fly, it covers the encoded bytes only
+    if (decoder->getEncoding() == ContentEncoding::Identity)
+        expectedDigest = digestFromHeaders(res);
+    if (expectedDigest)
+        digest = std::make_unique<FileDigest>(expectedDigest->algorithm);
+
+    bodyDelimited = true;
+    if (res.getHeader(Headers::TransferEncoding) == "chunked")
+        reader.beginBody(BodyFraming::Chunked);
+    else if (!contentLengthString.empty())
+        reader.beginBody(BodyFraming::ContentLength, contentLength);
+    else
+    {
+        reader.beginBody(BodyFraming::UntilClose);
+        bodyDelimited = false;
+    }
+
+    return true;
+}
+
+// wait for the socket to become ready for what the last step needs
+void AsyncDownload::watch(IoStatus status)
+{
+    // a download over its rate limit sleeps on a timer, the socket stays unwatched meanwhile
+    int fd = status == IoStatus::WantTime ? armTimer(reader.getThrottleDelay()) : sock->getPollFd();
+    uint32_t events = status == IoStatus::WantWrite ? EPOLLOUT : EPOLLIN;
+
+    // connecting to the next address gives a new fd
+    if (fd != watchedFd)
+    {
+        unwatch();
+        reactor.add(fd, events, [this, fd](uint32_t)
+                    {
+                        // the expiration has to be read or the timer stays readable
+                        uint64_t expirations;
+                        if (fd == timerFd && read(timerFd, &expirations, sizeof(expirations)) < 0)
+                            expirations = 0;
+                        advance(); });
+        watchedFd = fd;
+        watchedEvents = events;
+    }
+    else if (events != watchedEvents)
+    {
+        reactor.modify(fd, events);
+        watchedEvents = events;
+    }
+}
+
+// start the one shot timer of this download, created on the first pause
+int AsyncDownload::armTimer(std::chrono::milliseconds delay)
+{
+    if (timerFd < 0)
+    {
+        timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (timerFd < 0)
+            throw std::runtime_error("failed to create the rate limit timer: " + std::string(strerror(errno)));
+    }
+
+    // zero would disarm the timer
+    if (delay.count() <= 0)
+        delay = std::chrono::milliseconds(1);
+
+    itimerspec spec{};
+    spec.it_value.tv_sec = delay.count() / 1000;
+    spec.it_value.tv_nsec = (delay.count() % 1000) * 1000000;
+    timerfd_settime(timerFd, 0, &spec, nullptr);
+    return timerFd;
+}
+
+void AsyncDownload::unwatch()
+{
+    if (watchedFd >= 0)
+        reactor.remove(watchedFd);
+    watchedFd = -1;
+    watchedEvents = 0;
+}
+
+// leave the reactor, close the connection and report the result
+void AsyncDownload::finish(DownloadState finalState, const std::string &reason)
+{
+    unwatch();
+    state = finalState;
+    error = reason;
+
+    // a cancelled download is queued again and timed anew
+    if (finalState != DownloadState::Cancelled)
+        timer.finished(received, finalState != DownloadState::Done);
+
+    // the connection can serve the next request when the whole response was read
+    if (sock && pool && finalState == DownloadState::Done && bodyDelimited && res.keepsAlive() &&
+        reader.getBuffered().empty())
+        pool->release(parsedUrl, sock);
+    else if (sock)
+        sock->closeConnection();
+    sock = nullptr;
+
+    // a failed download keeps no partial file
+    if (sink)
+        sink->close();
+    if (finalState == DownloadState::Failed && !partPath.empty())
+        std::filesystem::remove(partPath);
+
+    if (onFinish)
+        onFinish(*this);
+}
+
+DownloadState AsyncDownload::getState() const
+{
+    return state;
+}
+
+const std::string &AsyncDownload::getUrl() const
+{
+    return url;
+}
+
+const ParsedUrl &AsyncDownload::getParsedUrl() const
+{
+    return parsedUrl;
+}
+
+const std::string &AsyncDownload::getError() const
+{
+    return error;
+}
+
+const std::string &AsyncDownload::getFilepath() const
+{
+    return filepath;
+}
+
+size_t AsyncDownload::getReceived() const
+{
+    return received;
+}
+
+size_t AsyncDownload::getSaved() const
+{
+    return decoder ? decoder->getDecompressedBytes() : 0;
+}
+
+size_t AsyncDownload::getContentLength() const
+{
+    return contentLength;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "../../event-loop/reactor/reactor.hpp"
+#include "../../http/content-decoder/content-decoder.hpp"
+#include "../../http/http-request/http-request.hpp"
+#include "../../http/http-response/http-response.hpp"
+#include "../../http/http-stream-reader/http-stream-reader.hpp"
+#include "../../io/download-sink/download-sink.hpp"
+#include "../../io/file-digest/file-digest.hpp"
+#include "../../metrics/transfer-metrics/transfer-metrics.hpp"
+#include "../../socket-lib/connection-pool/connection-pool.hpp"
+#include "../../socket-lib/socket-factory/socket-factory.hpp"
+#include "../../utils/utils.hpp"
+#include "../resume-state/resume-state.hpp"
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <sys/timerfd.h>
+
+// steps of a download driven by the reactor
+enum class DownloadState
+{
+    Connecting,
+    SendingRequest,
+    ReadingHeaders,
+    ReadingBody,
+    Done,
+    Failed,
+    Cancelled,
+};
+
+// a single url downloaded with a non-blocking socket, every step runs when the
+// reactor reports the socket ready so one thread can drive hundreds of them
+class AsyncDownload
+{
+    std::string url;
+    ParsedUrl parsedUrl;
+    Reactor &reactor;
+    ConnectionPool *pool; // keep-alive connections come from and go back here, nullptr to close them
+    std::shared_ptr<ISocket> sock;
+    bool reusedConnection; // sock came from the pool and may have been closed by the server meanwhile
+    bool responseStarted;  // a byte of the response arrived on this connection
+    bool retried;          // the request was already sent again once
+    bool bodyDelimited;    // the body end is known without the server closing the connection
+    HttpStreamReader reader;
+    std::shared_ptr<RateLimiter> limiter; // shared by the connections this download goes through
+    int timerFd;                          // wakes a download paused by the rate limit, -1 till needed
+    TransferTimer timer;
+    std::string request;
+    size_t requestSent;   // bytes of the request already sent
+    HttpResponse res;
+    std::unique_ptr<DownloadSink> sink;
+    bool compressed;                         // Accept-Encoding was sent, only then is a body decoded
+    std::unique_ptr<ContentDecoder> decoder; // undoes the Content-Encoding before the sink
+    std::unique_ptr<FileDigest> digest;      // hashes what reaches the sink when the server sent a digest
+    std::optional<ExpectedDigest> expectedDigest;
+    std::string filepath;
+    std::string partPath;
+    DownloadState state;
+    std::string error;
+    size_t received;      // body bytes received, before decompression
+    size_t contentLength; // 0 when unknown
+    int watchedFd;        // fd registered with the reactor, -1 when none
+    uint32_t watchedEvents;
+    std::function<void(AsyncDownload &)> onFinish;
+    std::function<bool(AsyncDownload &)> onResponse;
+    std::function<std::string(const std::string &, const std::string &)> claimPath;
+
+public:
+    AsyncDownload(const std::string &url, Reactor &reactor, ConnectionPool *pool = nullptr);
+    ~AsyncDownload();
+    AsyncDownload(const AsyncDownload &) = delete;
+    AsyncDownload &operator=(const AsyncDownload &) = delete;
+
+    // connect and register with the reactor, onFinish runs once it is done or failed
+    void start(std::function<void(AsyncDownload &)> onFinish = nullptr);
+
+    // runs once the response headers are in, returning false cancels the download
+    void setResponseHandler(std::function<bool(AsyncDownload &)> handler);
+
+    // picks the output path from the filename and extension, downloads/<name><ext> without one
+    void setPathClaimer(std::function<std::string(const std::string &, const std::string &)> claimer);
+
+    // ask for gzip/deflate/br bodies, they are decompressed before reaching the file
+    void setCompressed(bool enabled);
+
+    DownloadState getState() const;
+    const std::string &getUrl() const;
+    const ParsedUrl &getParsedUrl() const;
+    const std::string &getError() const;
+    const std::string &getFilepath() const;
+    size_t getReceived() const;
+    size_t getSaved() const; // bytes written to the file, differs from received for compressed bodies
+    size_t getContentLength() const;
+
+private:
+    void advance();
+    void connect();
+    bool retryOnNewConnection();
+    bool onHeaders();
+    void watch(IoStatus status);
+    void unwatch();
+    int armTimer(std::chrono::milliseconds delay);
+    void finish(DownloadState finalState, const std::string &reason = "");
+};
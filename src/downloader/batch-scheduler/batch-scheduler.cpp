@@ -0,0 +1,300 @@
+#include "batch-scheduler.hpp"
+
+BatchScheduler::BatchScheduler(const BatchLimits &limits)
+    : reactor(), pool(), limits(limits), jobs(), pending(), running(), completed(), activePerHost(), claimedPaths(), activeLarge(0),
+      compressed(false), startedAt(), endedAt() {}
+
+void BatchScheduler::setCompressed(bool enabled)
+{
+    this->compressed = enabled;
+}
+
+// queue a url, nothing starts before run
+void BatchScheduler::add(const std::string &url, JobPriority priority)
+{
+    ParsedUrl parsed = parseUrl(url);
+
+    BatchJob job;
+    job.url = url;
+    job.priority = priority;
+    job.hostKey = ConnectionPool::keyOf(parsed);
+    job.queuedAt = std::chrono::steady_clock::now();
+
+    jobs.push_back(job);
+    pending.push_back(jobs.size() - 1);
+}
+
+// read a batch list, empty lines and lines starting with # are skipped
+void BatchScheduler::addFrom(std::istream &input)
+{
+    std::string line;
+    while (std::getline(input, line))
+    {
+        std::istringstream words(line);
+        std::vector<std::string> fields;
+        for (std::string word; words >> word;)
+            fields.push_back(word);
+
+        if (fields.empty() || fields[0].starts_with("#"))
+            continue;
+        if (fields.size() > 2)
+            throw std::runtime_error("invalid batch line: " + line);
+
+        add(fields[0], fields.size() == 2 ? parsePriority(fields[1]) : JobPriority::Normal);
+    }
+}
+
+size_t BatchScheduler::size() const
+{
+    return jobs.size();
+}
+
+// start jobs whenever a slot frees up until all of them are done
+void BatchScheduler::run()
+{
+    startedAt = std::chrono::steady_clock::now();
+
+    while (true)
+    {
+        fill();
+
+        // a download can fail while starting, its slot is free right away
+        if (!completed.empty())
+        {
+            reap();
+            continue;
+        }
+
+        if (running.empty())
+            break;
+
+        reactor.runOnce(1000);
+        reap();
+        pool.closeExpired();
+    }
+
+    endedAt = std::chrono::steady_clock::now();
+    pool.closeAll();
+}
+
+size_t BatchScheduler::failures() const
+{
+    size_t failed = 0;
+    for (const BatchJob &job : jobs)
+        if (job.failed)
+            failed++;
+    return failed;
+}
+
+// throughput of the whole batch and the reason of every failure
+void BatchScheduler::printSummary(std::ostream &out) const
+{
+    size_t totalBytes = 0;
+    size_t savedBytes = 0;
+    int deferrals = 0;
+    for (const BatchJob &job : jobs)
+    {
+        totalBytes += job.bytes;
+        savedBytes += job.savedBytes;
+        deferrals += job.deferrals;
+    }
+
+    double seconds = std::chrono::duration<double>(endedAt - startedAt).count();
+    double mbps = seconds > 0 ? totalBytes / seconds / (1024 * 1024) : 0;
+
+    out << "batch summary: " << jobs.size() - failures() << " of " << jobs.size() << " downloads completed, "
+        << failures() << " failed\n"
+        << "  " << totalBytes << " bytes in " << seconds << "s (" << mbps << " MB/s)\n";
+
+    if (savedBytes != totalBytes)
+        out << "  " << savedBytes << " bytes saved after decompression\n";
+
+    out << "  " << pool.getCreated() << " connections opened, " << pool.getReused() << " requests reused one\n";
+
+    TlsContext &tls = TlsContext::instance();
+    if (tls.getResumedHandshakes() + tls.getFullHandshakes() > 0)
+        out << "  " << tls.getFullHandshakes() << " full TLS handshakes, " << tls.getResumedHandshakes()
+            << " resumed\n";
+
+    if (deferrals > 0)
+        out << "  " << deferrals << " large downloads waited for a bulk slot\n";
+
+    for (const BatchJob &job : jobs)
+        if (job.failed)
+            out << "  failed " << job.url << ": " << job.error << "\n";
+}
+
+// bulk downloads may use all slots but a quarter
+int BatchScheduler::largeLimit() const
+{
+    if (limits.maxActive == 1)
+        return 1;
+    return limits.maxActive - std::max(1, limits.maxActive / 4);
+}
+
+bool BatchScheduler::canStart(const BatchJob &job) const
+{
+    auto it = activePerHost.find(job.hostKey);
+    if (it != activePerHost.end() && it->second >= limits.perHost)
+        return false;
+
+    return !job.large || activeLarge < largeLimit();
+}
+
+// lower rank starts first, waiting long enough lifts a job by a class
+int BatchScheduler::rank(const BatchJob &job) const
+{
+    auto waited = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - job.queuedAt);
+    return (int)job.priority - (int)(waited.count() / BATCH_AGING_MS);
+}
+
+// start the best waiting jobs that fit into the free slots
+void BatchScheduler::fill()
+{
+    while ((int)running.size() < limits.maxActive && !pending.empty())
+    {
+        // pending is in queue order so the first best one is the oldest of its rank
+        auto best = pending.end();
+        int bestRank = 0;
+
+        for (auto it = pending.begin(); it != pending.end(); it++)
+        {
+            const BatchJob &job = jobs[*it];
+            if (!canStart(job))
+                continue;
+
+            int jobRank = rank(job);
+            if (best == pending.end() || jobRank < bestRank)
+            {
+                best = it;
+                bestRank = jobRank;
+            }
+        }
+
+        // every waiting job is blocked by its host or the bulk lane
+        if (best == pending.end())
+            return;
+
+        size_t index = *best;
+        pending.erase(best);
+        start(index);
+    }
+}
+
+void BatchScheduler::start(size_t index)
+{
+    BatchJob &job = jobs[index];
+    activePerHost[job.hostKey]++;
+    if (job.large)
+    {
+        job.bulkSlot = true;
+        activeLarge++;
+    }
+
+    auto download = std::make_unique<AsyncDownload>(job.url, reactor, &pool);
+    AsyncDownload *raw = download.get();
+    running[index] = std::move(download);
+
+    raw->setCompressed(compressed);
+    raw->setResponseHandler([this, index](AsyncDownload &download)
+                            { return admitResponse(index, download); });
+    raw->setPathClaimer([this](const std::string &filename, const std::string &extension)
+                        { return claimPath(filename, extension); });
+
+    // the download is destroyed by reap, not while its callback runs
+    raw->start([this, index](AsyncDownload &)
+               { completed.push_back(index); });
+}
+
+// a download that turns out large needs a bulk slot, otherwise it waits in the queue
+bool BatchScheduler::admitResponse(size_t index, AsyncDownload &download)
+{
+    BatchJob &job = jobs[index];
+    if (job.large || download.getContentLength() < limits.largeJobSize)
+        return true;
+
+    job.large = true;
+    if (activeLarge < largeLimit())
+    {
+        job.bulkSlot = true;
+        activeLarge++;
+        return true;
+    }
+
+    job.deferrals++;
+    return false;
+}
+
+// release the slots of finished downloads
+void BatchScheduler::reap()
+{
+    for (size_t index : completed)
+    {
+        BatchJob &job = jobs[index];
+        std::unique_ptr<AsyncDownload> download = std::move(running[index]);
+        running.erase(index);
+
+        activePerHost[job.hostKey]--;
+
+        DownloadState state = download->getState();
+
+        if (job.bulkSlot)
+            activeLarge--;
+        job.bulkSlot = false;
+
+        if (state == DownloadState::Cancelled)
+        {
+            pending.push_back(index);
+            continue;
+        }
+
+        job.finished = true;
+        job.bytes = download->getReceived();
+        job.savedBytes = download->getSaved();
+
+        if (state == DownloadState::Done)
+            std::clog << "saved " << download->getFilepath() << " (" << job.savedBytes << " bytes)" << std::endl;
+        else
+        {
+            job.failed = true;
+            job.error = download->getError();
+            std::clog << "failed " << job.url << ": " << job.error << std::endl;
+        }
+    }
+
+    completed.clear();
+}
+
+// urls ending in the same name would share one part file, the later ones get "name (1).ext"
+std::string BatchScheduler::claimPath(const std::string &filename, const std::string &extension)
+{
+    std::string path = "downloads/" + filename + extension;
+
+    // the extension may still be part of the name taken from the url
+    std::string stem = filename, suffix = extension;
+    size_t dot = stem.rfind('.');
+    if (suffix.empty() && dot != std::string::npos && dot > 0)
+    {
+        suffix = stem.substr(dot);
+        stem.resize(dot);
+    }
+
+    for (int n = 1; claimedPaths.contains(path); n++)
+        path = "downloads/" + stem + " (" + std::to_string(n) + ")" + suffix;
+
+    claimedPaths.insert(path);
+    return path;
+}
+
+// parse the priority column of a batch line
+JobPriority parsePriority(const std::string &value)
+{
+    if (value == "high")
+        return JobPriority::High;
+    if (value == "normal")
+        return JobPriority::Normal;
+    if (value == "low")
+        return JobPriority::Low;
+
+    throw std::runtime_error("unknown priority " + value);
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "../../event-loop/reactor/reactor.hpp"
+#include "../async-download/async-download.hpp"
+#include <chrono>
+#include <istream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#define BATCH_LARGE_JOB_SIZE (64LL * 1024 * 1024) // is se bade downloads bulk lane me jayenge
+#define BATCH_AGING_MS 30000                      // waiting this long moves a job one class up
+
+// classes of a batch entry, a higher class starts first
+enum class JobPriority
+{
+    High,
+    Normal,
+    Low,
+};
+
+// a url of the batch and what happened to it
+struct BatchJob
+{
+    std::string url;
+    JobPriority priority = JobPriority::Normal;
+    std::string hostKey;        // scheme://host:port the per host cap and the connection pool count on
+    bool large = false;         // known to need a bulk slot
+    bool bulkSlot = false;      // running in one of the bulk slots
+    bool finished = false;
+    bool failed = false;
+    std::string error;
+    size_t bytes = 0;           // received on the wire
+    size_t savedBytes = 0;      // written to the file, more than bytes when it came compressed
+    int deferrals = 0;          // times it was put back because the bulk lane was full
+    std::chrono::steady_clock::time_point queuedAt;
+};
+
+struct BatchLimits
+{
+    int maxActive = 8; // downloads running at the same time
+    int perHost = 4;   // downloads running against one host at the same time
+    size_t largeJobSize = BATCH_LARGE_JOB_SIZE;
+};
+
+// runs a list of urls on one reactor with a global limit and per host caps.
+// a download found to be larger than largeJobSize needs a bulk slot, at least
+// a quarter of the slots are kept free of bulk downloads so short jobs keep
+// moving. when the bulk lane is full such a download is dropped after its
+// headers and queued again as a known bulk job.
+class BatchScheduler
+{
+    Reactor reactor;
+    ConnectionPool pool;
+    BatchLimits limits;
+    std::vector<BatchJob> jobs;
+    std::vector<size_t> pending; // indices of jobs waiting to start
+    std::unordered_map<size_t, std::unique_ptr<AsyncDownload>> running;
+    std::vector<size_t> completed; // finished since the last reap
+    std::unordered_map<std::string, int> activePerHost;
+    std::unordered_set<std::string> claimedPaths; // output files taken by a job of this batch
+    int activeLarge;
+    bool compressed; // downloads ask for compressed bodies
+    std::chrono::steady_clock::time_point startedAt;
+    std::chrono::steady_clock::time_point endedAt;
+
+public:
+    explicit BatchScheduler(const BatchLimits &limits);
+
+    void add(const std::string &url, JobPriority priority = JobPriority::Normal);
+    void addFrom(std::istream &input); // one url per line, optionally followed by high, normal or low
+    size_t size() const;
+    void setCompressed(bool enabled);
+
+    void run(); // returns when every job has finished or failed
+    size_t failures() const;
+    void printSummary(std::ostream &out) const;
+
+private:
+    int largeLimit() const;
+    bool canStart(const BatchJob &job) const;
+    void fill();
+    void start(size_t index);
+    bool admitResponse(size_t index, AsyncDownload &download);
+    void reap();
+    std::string claimPath(const std::string &filename, const std::string &extension);
+    int rank(const BatchJob &job) const;
+};
+
+JobPriority parsePriority(const std::string &value);
@@ -0,0 +1,229 @@
+#include "range-downloader.hpp"
+
+// create a downloader for a resource which supports range requests
+RangeDownloader::RangeDownloader(const ParsedUrl &u, const std::string &path, size_t length, int conns, size_t depth)
+    : url(u), filepath(path), contentLength(length), connections(conns), queueDepth(depth), downloadedBytes(0),
+      limiter(RateLimits::instance().forDownload(u.host)), expectedDigest() {}
+
+void RangeDownloader::setExpectedDigest(const ExpectedDigest &expected)
+{
+    this->expectedDigest = expected;
+}
+
+// split the content into at most `parts` contiguous ranges of nearly equal size
+std::vector<ByteRange> RangeDownloader::splitRanges(size_t contentLength, int parts)
+{
+    std::vector<ByteRange> ranges;
+    if (contentLength == 0 || parts <= 0)
+        return ranges;
+
+    // dont make segments smaller than the minimum size
+    size_t maxParts = std::max<size_t>(1, contentLength / MIN_SEGMENT_SIZE);
+    size_t noOfParts = std::min<size_t>(parts, maxParts);
+
+    size_t segmentSize = contentLength / noOfParts;
+    size_t extraBytes = contentLength % noOfParts;
+
+    size_t start = 0;
+    for (size_t i = 0; i < noOfParts; i++)
+    {
+        // first few segments take one extra byte of the remainder
+        size_t length = segmentSize + (i < extraBytes ? 1 : 0);
+        ranges.push_back({start, start + length - 1});
+        start += length;
+    }
+
+    return ranges;
+}
+
+// download every range over its own connection and write it at its offset
+void RangeDownloader::download()
+{
+    std::vector<ByteRange> ranges = splitRanges(contentLength, connections);
+    std::string partPath = filepath + ".part";
+
+    // the ranges land out of order and their progress isnt saved, so the size of
+    // an old part file cannot tell which bytes it holds and it must never be resumed
+    ResumeState::discard(partPath);
+
+    // reserve the whole file upfront so that ranges can be written anywhere
+    DownloadSink sink(partPath);
+    sink.preallocate(contentLength);
+
+    // every connection hands its data to one writer thread
+    TransferPipeline pipeline(sink, queueDepth);
+
+    std::clog << "downloading " << contentLength << " bytes using "
+              << ranges.size() << " connections" << std::endl;
+
+    std::vector<std::thread> workers;
+    std::vector<std::exception_ptr> errors(ranges.size());
+    SegmentTable segments(ranges);
+
+    // shows the combined status of all the connections till they finish
+    ProgressDisplay progress([this]()
+                             { return downloadedBytes.load(); }, contentLength);
+
+    for (size_t i = 0; i < ranges.size(); i++)
+    {
+        workers.emplace_back([this, &segments, &errors, &pipeline, i]()
+                             {
+                                 try
+                                 {
+                                     runConnection(i, segments, pipeline);
+                                 }
+                                 catch (...)
+                                 {
+                                     errors[i] = std::current_exception();
+                                 } });
+    }
+
+    for (auto &worker : workers)
+        worker.join();
+
+    progress.stop();
+    pipeline.finish();
+    pipeline.logStats();
+    sink.close();
+
+    if (segments.getStolen() > 0)
+        std::clog << "faster connections took over " << segments.getStolen() << " segments" << std::endl;
+
+    if (url.scheme == "https")
+        std::clog << "TLS handshakes: " << TlsContext::instance().getFullHandshakes() << " full, "
+                  << TlsContext::instance().getResumedHandshakes() << " resumed" << std::endl;
+
+    // report the first failed range, the partial file is kept as it is
+    for (const auto &error : errors)
+        if (error)
+            std::rethrow_exception(error);
+
+    // the ranges arrive out of order, so the file is hashed once it is complete,
+    // mostly from the page cache as it was just written
+    if (expectedDigest)
+    {
+        FileDigest digest(expectedDigest->algorithm);
+        digest.updateFromFile(partPath, contentLength);
+        std::string actual = digest.finish();
+        std::clog << digestName(expectedDigest->algorithm) << " " << actual << std::endl;
+
+        try
+        {
+            verifyDigest(*expectedDigest, actual);
+        }
+        catch (const std::exception &)
+        {
+            ResumeState::discard(partPath);
+            throw;
+        }
+    }
+
+    std::filesystem::rename(partPath, filepath);
+}
+
+// a connection which is done helps the slowest one, so all of them finish together
+void RangeDownloader::runConnection(size_t id, SegmentTable &segments, TransferPipeline &pipeline)
+{
+    std::shared_ptr<ISocket> sock;
+    std::optional<size_t> current = id;
+
+    while (current)
+    {
+        try
+        {
+            sock = downloadSegment(*current, segments, pipeline, sock);
+        }
+        catch (...)
+        {
+            // whats left of it is reported as failed, nobody should split it further
+            segments.release(*current);
+            throw;
+        }
+
+        segments.release(*current);
+        current = segments.steal();
+    }
+
+    if (sock)
+        sock->closeConnection();
+}
+
+// request what is left of the segment and write the received bytes at their offset,
+// reading stops early once another connection has stolen the tail
+std::shared_ptr<ISocket> RangeDownloader::downloadSegment(size_t id, SegmentTable &segments, TransferPipeline &pipeline,
+                                                          std::shared_ptr<ISocket> sock)
+{
+    ByteRange range = segments.getRange(id);
+    std::string rangeValue = "bytes=" + std::to_string(range.start) + "-" + std::to_string(range.end);
+    TransferTimer timer(url.scheme + "://" + url.host + url.path + " " + rangeValue);
+
+    if (!sock)
+    {
+        sock = createSocket(url);
+        sock->connectToServer();
+    }
+    timer.connected();
+
+    // kept alive so the connection can go on with a stolen segment
+    HttpRequest req = HttpRequest::makeGetRequest(url.host, url.path, true);
+    req.setHeader({"Range", rangeValue});
+    sock->sendAll(req.toString());
+    timer.requestSent();
+
+    HttpStreamReader reader(sock);
+    reader.setProgressLogging(false);
+    reader.setRateLimiter(limiter);
+
+    HttpResponse res;
+    reader.readResponse(res);
+    timer.firstByte();
+
+    // anything other than partial content would put wrong bytes at this offset
+    if (res.getStatusCode() != 206)
+        throw std::runtime_error("range " + std::to_string(range.start) + "-" + std::to_string(range.end) +
+                                 " failed with status " + std::to_string(res.getStatusCode()));
+
+    // a server may answer with a different range than asked for, its bytes dont belong at this offset
+    ContentRange contentRange = parseContentRange(std::string(res.getHeader(Headers::ContentRange)));
+    if (contentRange.start != (long long)range.start || contentRange.end != (long long)range.end)
+        throw std::runtime_error("asked for range " + std::to_string(range.start) + "-" + std::to_string(range.end) +
+                                 " but got " + std::string(res.getHeader(Headers::ContentRange)));
+
+    // one pipeline buffer per read
+    std::vector<char> data(PIPELINE_BUFFER_SIZE);
+    size_t offset = range.start;
+
+    while (!segments.isDone(id))
+    {
+        // the end may have moved back since the last read
+        size_t wanted = std::min(data.size(), segments.getRange(id).length());
+        size_t received = reader.readContentInto(std::span<char>(data.data(), wanted), nullptr);
+
+        // the bytes past a freshly stolen end are dropped, the thief fetches them
+        size_t accepted = segments.accept(id, received);
+        pipeline.writeAt(offset, data.data(), accepted);
+        offset += accepted;
+        downloadedBytes += accepted;
+
+        if (received < wanted)
+            break;
+    }
+
+    bool complete = segments.isDone(id);
+    timer.finished(offset - range.start, !complete);
+
+    if (!complete)
+    {
+        sock->closeConnection();
+        throw std::runtime_error("range " + std::to_string(range.start) + "-" + std::to_string(range.end) +
+                                 " ended after " + std::to_string(offset - range.start) + " bytes");
+    }
+
+    // a shortened range leaves the rest of the response unread on the connection
+    if (offset != range.end + 1 || !res.keepsAlive())
+    {
+        sock->closeConnection();
+        return nullptr;
+    }
+    return sock;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "../../http/http-request/http-request.hpp"
+#include "../../http/http-response/http-response.hpp"
+#include "../../http/http-stream-reader/http-stream-reader.hpp"
+#include "../../io/download-sink/download-sink.hpp"
+#include "../../io/file-digest/file-digest.hpp"
+#include "../../io/transfer-pipeline/transfer-pipeline.hpp"
+#include "../../metrics/progress-display/progress-display.hpp"
+#include "../../metrics/transfer-metrics/transfer-metrics.hpp"
+#include "../../socket-lib/socket-factory/socket-factory.hpp"
+#include "../../utils/utils.hpp"
+#include "../resume-state/resume-state.hpp"
+#include "../segment-table/segment-table.hpp"
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define MIN_SEGMENT_SIZE 65536 // ek segment kam se kam 64KB ka hoga
+
+class RangeDownloader
+{
+    ParsedUrl url;
+    std::string filepath;       // final path of the downloaded file
+    size_t contentLength;       // total size of the resource
+    int connections;            // no of parallel range requests
+    size_t queueDepth;          // buffers allowed to wait for the disk
+    std::atomic<size_t> downloadedBytes;
+    std::shared_ptr<RateLimiter> limiter; // one download limit shared by all the ranges
+    std::optional<ExpectedDigest> expectedDigest;
+
+public:
+    RangeDownloader(const ParsedUrl &url, const std::string &filepath, size_t contentLength, int connections,
+                    size_t queueDepth = PIPELINE_QUEUE_DEPTH);
+    void download(); // downloads all the ranges in parallel into the file
+    void setExpectedDigest(const ExpectedDigest &expected); // checked before the file gets its final name
+    static std::vector<ByteRange> splitRanges(size_t contentLength, int parts);
+
+private:
+    // downloads segment id and then steals from the slower connections till nothing is worth taking
+    void runConnection(size_t id, SegmentTable &segments, TransferPipeline &pipeline);
+    // request what is left of segment id over sock (a new connection when null), returns the
+    // socket when it can carry the next request
+    std::shared_ptr<ISocket> downloadSegment(size_t id, SegmentTable &segments, TransferPipeline &pipeline,
+                                             std::shared_ptr<ISocket> sock);
+};
@@ -0,0 +1,73 @@
+#include "resume-state.hpp"
+
+// path of the file holding the validators of a partial file
+static std::string metaPathOf(const std::string &partPath)
+{
+    return partPath + ".meta";
+}
+
+// If-Range only accepts strong etags, otherwise fallback to the date
+std::string ResumeState::ifRangeValue() const
+{
+    if (!etag.empty() && !etag.starts_with("W/"))
+        return etag;
+
+    return lastModified;
+}
+
+// both have to agree on every validator the server has given
+bool ResumeState::matches(const ResumeState &other) const
+{
+    if (etag.empty() && lastModified.empty())
+        return false;
+
+    return etag == other.etag && lastModified == other.lastModified;
+}
+
+// write the validators as header lines so that they can be parsed back as headers
+void ResumeState::save(const std::string &partPath) const
+{
+    std::ofstream file(metaPathOf(partPath), std::ios::binary | std::ios::trunc);
+    if (!file)
+        throw std::runtime_error("failed to create/open the file " + metaPathOf(partPath));
+
+    file << "ETag: " << etag << "\r\n"
+         << "Last-Modified: " << lastModified << "\r\n";
+}
+
+// take the validators from the response headers
+ResumeState ResumeState::fromResponse(HttpResponse &res)
+{
+    return ResumeState{std::string(res.getHeader(Headers::ETag)), std::string(res.getHeader(Headers::LastModified))};
+}
+
+// read the stored validators of a partial file if present
+std::optional<ResumeState> ResumeState::load(const std::string &partPath)
+{
+    std::ifstream file(metaPathOf(partPath), std::ios::binary);
+    if (!file)
+        return std::nullopt;
+
+    std::ostringstream content;
+    content << file.rdbuf();
+
+    HttpResponse stored;
+    stored.setHeaders(HttpResponse::parseHeaders(content.str()));
+
+    return fromResponse(stored);
+}
+
+// remove the partial file along with its validators
+void ResumeState::discard(const std::string &partPath)
+{
+    std::error_code ec;
+    std::filesystem::remove(partPath, ec);
+    std::filesystem::remove(metaPathOf(partPath), ec);
+}
+
+// forget the validators but keep the partial file
+void ResumeState::discardState(const std::string &partPath)
+{
+    std::error_code ec;
+    std::filesystem::remove(metaPathOf(partPath), ec);
+}
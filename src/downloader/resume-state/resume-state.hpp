@@ -0,0 +1,26 @@
+#pragma once
+
+#include "../../http/http-response/http-response.hpp"
+#include "../../utils/utils.hpp"
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <string>
+
+// validators of the resource a partial download belongs to,
+// stored next to the partial file as <file>.part.meta
+struct ResumeState
+{
+    std::string etag;
+    std::string lastModified;
+
+    std::string ifRangeValue() const;               // validator to send in If-Range, empty when none usable
+    bool matches(const ResumeState &other) const;   // whether both describe the same version of the resource
+    void save(const std::string &partPath) const;
+
+    static ResumeState fromResponse(HttpResponse &res);
+    static std::optional<ResumeState> load(const std::string &partPath);
+    static void discard(const std::string &partPath); // removes the partial file with its state
+    static void discardState(const std::string &partPath); // removes only the state, the file cant be resumed then
+};
@@ -0,0 +1,75 @@
+#include "segment-table.hpp"
+
+// every range starts as an active segment with nothing received
+SegmentTable::SegmentTable(const std::vector<ByteRange> &ranges) : segments(), stolen(0), mutex()
+{
+    segments.reserve(ranges.size());
+    for (const ByteRange &range : ranges)
+        segments.push_back({range.start, range.start, range.end, true});
+}
+
+size_t SegmentTable::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return segments.size();
+}
+
+ByteRange SegmentTable::getRange(size_t id) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return {segments[id].next, segments[id].end};
+}
+
+size_t SegmentTable::getStolen() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return stolen;
+}
+
+// bytes past the current end belong to the thief now and are dropped by the caller
+size_t SegmentTable::accept(size_t id, size_t n)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Segment &segment = segments[id];
+
+    size_t accepted = std::min(n, segment.remaining());
+    segment.next += accepted;
+    return accepted;
+}
+
+bool SegmentTable::isDone(size_t id) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return segments[id].remaining() == 0;
+}
+
+void SegmentTable::release(size_t id)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    segments[id].active = false;
+}
+
+std::optional<size_t> SegmentTable::steal()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    Segment *victim = nullptr;
+    for (Segment &segment : segments)
+    {
+        if (segment.active && (!victim || segment.remaining() > victim->remaining()))
+            victim = &segment;
+    }
+
+    // both halves should be big enough to pay for the extra request
+    if (!victim || victim->remaining() < 2 * MIN_STEAL_SIZE)
+        return std::nullopt;
+
+    // the victim keeps the front half, its connection is already streaming it
+    size_t middle = victim->next + victim->remaining() / 2;
+    size_t end = victim->end;
+    victim->end = middle - 1;
+
+    segments.push_back({middle, middle, end, true});
+    stolen++;
+    return segments.size() - 1;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#define MIN_STEAL_SIZE 262144 // 256KB se chhota hissa churane layak nahi, naya request mehenga padta hai
+
+// inclusive byte range of the resource, same as the Range header
+struct ByteRange
+{
+    size_t start;
+    size_t end;
+
+    size_t length() const { return end - start + 1; }
+};
+
+// a range one connection is responsible for, its end moves back when another
+// connection steals the rest of it
+struct Segment
+{
+    size_t start;
+    size_t next; // first byte not received yet
+    size_t end;  // inclusive, only ever shrinks
+    bool active; // a connection is still working on it
+
+    size_t remaining() const { return next > end ? 0 : end + 1 - next; }
+};
+
+// the segments of one range download, every byte of the resource belongs to
+// exactly one of them so no byte is written twice
+class SegmentTable
+{
+    std::vector<Segment> segments;
+    size_t stolen; // segments created by stealing
+    mutable std::mutex mutex;
+
+public:
+    explicit SegmentTable(const std::vector<ByteRange> &ranges);
+
+    size_t size() const;
+    ByteRange getRange(size_t id) const; // what is left of the segment, start is the next byte to receive
+    size_t getStolen() const;
+
+    // the connection of segment id received n bytes at its next offset, returns how many
+    // of them still belong to it. less than n once the tail was stolen
+    size_t accept(size_t id, size_t n);
+    bool isDone(size_t id) const;
+    void release(size_t id); // the connection gave up on the segment, it wont be stolen from anymore
+
+    // move the back half of the active segment with the most bytes left into a new
+    // segment, returns its id or nothing when no segment is worth splitting
+    std::optional<size_t> steal();
+};
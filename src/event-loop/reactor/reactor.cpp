@@ -0,0 +1,93 @@
+#include "reactor.hpp"
+
+Reactor::Reactor() : epollFd(epoll_create1(EPOLL_CLOEXEC)), handlers()
+{
+    if (epollFd < 0)
+        throw std::runtime_error(std::string("epoll_create1 failed: ") + strerror(errno));
+}
+
+Reactor::~Reactor()
+{
+    ::close(epollFd);
+}
+
+// start watching a fd, the handler gets the ready events
+void Reactor::add(int fd, uint32_t events, std::function<void(uint32_t)> handler)
+{
+    epoll_event event{};
+    event.events = events;
+    event.data.fd = fd;
+
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0)
+        throw std::runtime_error(std::string("epoll_ctl add failed: ") + strerror(errno));
+
+    handlers[fd] = std::move(handler);
+}
+
+// change the events a watched fd waits for
+void Reactor::modify(int fd, uint32_t events)
+{
+    epoll_event event{};
+    event.events = events;
+    event.data.fd = fd;
+
+    if (epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event) == 0)
+        return;
+
+    // the fd was closed and the same number got reused, epoll forgot the old one
+    if (errno != ENOENT || epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0)
+        throw std::runtime_error(std::string("epoll_ctl mod failed: ") + strerror(errno));
+}
+
+// stop watching a fd, must be called before the fd is closed
+void Reactor::remove(int fd)
+{
+    if (handlers.erase(fd) == 0)
+        return;
+
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+bool Reactor::watches(int fd) const
+{
+    return handlers.contains(fd);
+}
+
+bool Reactor::empty() const
+{
+    return handlers.empty();
+}
+
+// wait for ready fds and call their handlers
+size_t Reactor::runOnce(int timeoutMs)
+{
+    epoll_event events[REACTOR_MAX_EVENTS];
+
+    int ready = epoll_wait(epollFd, events, REACTOR_MAX_EVENTS, timeoutMs);
+    if (ready < 0)
+    {
+        if (errno == EINTR)
+            return 0;
+        throw std::runtime_error(std::string("epoll_wait failed: ") + strerror(errno));
+    }
+
+    for (int i = 0; i < ready; i++)
+    {
+        // an earlier handler of this batch may have removed the fd
+        auto it = handlers.find(events[i].data.fd);
+        if (it == handlers.end())
+            continue;
+
+        // copy so the handler can remove itself while running
+        std::function<void(uint32_t)> handler = it->second;
+        handler(events[i].events);
+    }
+
+    return ready;
+}
+
+void Reactor::run()
+{
+    while (!empty())
+        runOnce();
+}
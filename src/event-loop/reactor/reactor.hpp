@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#define REACTOR_MAX_EVENTS 256 // events taken from epoll in one wait
+
+// waits on many file descriptors with epoll and calls the handler of every
+// ready one, level triggered so a handler can leave data for the next round
+class Reactor
+{
+    int epollFd;
+    std::unordered_map<int, std::function<void(uint32_t)>> handlers;
+
+public:
+    Reactor();
+    ~Reactor();
+    Reactor(const Reactor &) = delete;
+    Reactor &operator=(const Reactor &) = delete;
+
+    void add(int fd, uint32_t events, std::function<void(uint32_t)> handler);
+    void modify(int fd, uint32_t events);
+    void remove(int fd);
+    bool watches(int fd) const;
+    bool empty() const;
+
+    size_t runOnce(int timeoutMs = -1); // handles one batch of ready fds, returns how many
+    void run();                         // runs until no fd is watched anymore
+};
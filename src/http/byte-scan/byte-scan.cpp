@@ -0,0 +1,158 @@
+#include "byte-scan.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BYTE_SCAN_X86 1
+#endif
+
+static size_t findAnyOfScalar(const char *data, size_t size, char a, char b)
+{
+    for (size_t i = 0; i < size; i++)
+        if (data[i] == a || data[i] == b)
+            return i;
+    return size;
+}
+
+static bool isHexDigit(char c)
+{
+    char lower = c | 0x20;
+    return (c >= '0' && c <= '9') || (lower >= 'a' && lower <= 'f');
+}
+
+static size_t countHexDigitsScalar(const char *data, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+        if (!isHexDigit(data[i]))
+            return i;
+    return size;
+}
+
+#ifdef BYTE_SCAN_X86
+
+// 16 bytes per compare, part of every x86-64 cpu
+static size_t findAnyOfSse2(const char *data, size_t size, char a, char b)
+{
+    const __m128i first = _mm_set1_epi8(a);
+    const __m128i second = _mm_set1_epi8(b);
+
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, first), _mm_cmpeq_epi8(chunk, second)));
+        if (mask != 0)
+            return i + __builtin_ctz(mask);
+    }
+
+    return i + findAnyOfScalar(data + i, size - i, a, b);
+}
+
+// 32 bytes per compare, only called when the cpu reports AVX2
+__attribute__((target("avx2"))) static size_t findAnyOfAvx2(const char *data, size_t size, char a, char b)
+{
+    const __m256i first = _mm256_set1_epi8(a);
+    const __m256i second = _mm256_set1_epi8(b);
+
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32)
+    {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+        unsigned mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, first),
+                                                             _mm256_cmpeq_epi8(chunk, second)));
+        if (mask != 0)
+            return i + __builtin_ctz(mask);
+    }
+
+    return i + findAnyOfSse2(data + i, size - i, a, b);
+}
+
+// signed compares are fine, bytes above 0x7f are negative and never hex
+static size_t countHexDigitsSse2(const char *data, size_t size)
+{
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        __m128i lower = _mm_or_si128(chunk, _mm_set1_epi8(0x20));
+
+        __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8('0' - 1)),
+                                      _mm_cmplt_epi8(chunk, _mm_set1_epi8('9' + 1)));
+        __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                       _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+
+        int mask = ~_mm_movemask_epi8(_mm_or_si128(digit, letter)) & 0xffff;
+        if (mask != 0)
+            return i + __builtin_ctz(mask);
+    }
+
+    return i + countHexDigitsScalar(data + i, size - i);
+}
+
+__attribute__((target("avx2"))) static size_t countHexDigitsAvx2(const char *data, size_t size)
+{
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32)
+    {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+        __m256i lower = _mm256_or_si256(chunk, _mm256_set1_epi8(0x20));
+
+        __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(chunk, _mm256_set1_epi8('0' - 1)),
+                                         _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), chunk));
+        __m256i letter = _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)),
+                                          _mm256_cmpgt_epi8(_mm256_set1_epi8('f' + 1), lower));
+
+        unsigned mask = ~(unsigned)_mm256_movemask_epi8(_mm256_or_si256(digit, letter));
+        if (mask != 0)
+            return i + __builtin_ctz(mask);
+    }
+
+    return i + countHexDigitsSse2(data + i, size - i);
+}
+
+#endif
+
+using FindAnyOf = size_t (*)(const char *, size_t, char, char);
+
+using CountHexDigits = size_t (*)(const char *, size_t);
+
+struct ByteScanner
+{
+    FindAnyOf find;
+    CountHexDigits countHex;
+    const char *name;
+};
+
+// pick the widest version the cpu supports
+static ByteScanner selectScanner()
+{
+#ifdef BYTE_SCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return {findAnyOfAvx2, countHexDigitsAvx2, "avx2"};
+    return {findAnyOfSse2, countHexDigitsSse2, "sse2"};
+#else
+    return {findAnyOfScalar, countHexDigitsScalar, "scalar"};
+#endif
+}
+
+// selected on first use so it is ready even for callers running before main
+static const ByteScanner &scanner()
+{
+    static const ByteScanner selected = selectScanner();
+    return selected;
+}
+
+size_t findAnyOf(const char *data, size_t size, char a, char b)
+{
+    return scanner().find(data, size, a, b);
+}
+
+size_t countHexDigits(const char *data, size_t size)
+{
+    return scanner().countHex(data, size);
+}
+
+const char *byteScanImplementation()
+{
+    return scanner().name;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+
+// vectorised search for the delimiters of HTTP framing. on x86 the AVX2 or
+// SSE2 version is picked once at startup depending on the cpu, other
+// machines use the scalar loop.
+
+// position of the first byte equal to a or b, size when there is none
+size_t findAnyOf(const char *data, size_t size, char a, char b);
+
+// position of the first byte equal to c, size when there is none
+inline size_t findByte(const char *data, size_t size, char c)
+{
+    return findAnyOf(data, size, c, c);
+}
+
+// length of the run of hex digits at the start of data
+size_t countHexDigits(const char *data, size_t size);
+
+// name of the implementation in use: avx2, sse2 or scalar
+const char *byteScanImplementation();
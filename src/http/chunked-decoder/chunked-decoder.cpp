@@ -0,0 +1,148 @@
+#include "chunked-decoder.hpp"
+
+ChunkedDecoder::ChunkedDecoder() : state(ChunkState::Size), chunkRemaining(0), trailerBytes(0), trailers() {}
+
+size_t ChunkedDecoder::decode(std::string_view input, const std::function<void(std::string_view)> &onPayload)
+{
+    size_t pos = 0;
+
+    while (pos < input.size() && state != ChunkState::Done)
+    {
+        std::string_view rest = input.substr(pos);
+        size_t used = 0;
+
+        switch (state)
+        {
+        case ChunkState::Size:
+            used = decodeSizeLine(rest);
+            break;
+
+        case ChunkState::Data:
+            used = std::min(chunkRemaining, rest.size());
+            onPayload(rest.substr(0, used));
+            chunkRemaining -= used;
+            if (chunkRemaining == 0)
+                state = ChunkState::DataEnd;
+            break;
+
+        case ChunkState::DataEnd:
+            // Chunk ke data ke baad \r\n aata hai, usko discard karna padega (akela \n bhi chalega)
+            if (rest[0] == '\n')
+                used = 1;
+            else if (rest[0] != '\r')
+                throw std::runtime_error("Expected CRLF after chunk data");
+            else if (rest.size() < 2)
+                return pos;
+            else if (rest[1] != '\n')
+                throw std::runtime_error("Expected CRLF after chunk data");
+            else
+                used = 2;
+            state = ChunkState::Size;
+            break;
+
+        case ChunkState::Trailers:
+            used = decodeTrailer(rest);
+            break;
+
+        case ChunkState::Done:
+            break;
+        }
+
+        // the line is not complete yet
+        if (used == 0)
+            return pos;
+
+        pos += used;
+    }
+
+    return pos;
+}
+
+bool ChunkedDecoder::isDone() const
+{
+    return state == ChunkState::Done;
+}
+
+ChunkState ChunkedDecoder::getState() const
+{
+    return state;
+}
+
+void ChunkedDecoder::reset()
+{
+    state = ChunkState::Size;
+    chunkRemaining = 0;
+    trailerBytes = 0;
+    trailers.clear();
+}
+
+const HeaderMap &ChunkedDecoder::getTrailers() const
+{
+    return trailers;
+}
+
+// "1a2b;name=value\r\n", returns the bytes of the line or 0 when it is incomplete
+size_t ChunkedDecoder::decodeSizeLine(std::string_view input)
+{
+    size_t digits = countHexDigits(input.data(), input.size());
+    size_t lineEnd = digits < input.size() ? digits + findByte(input.data() + digits, input.size() - digits, '\n')
+                                           : input.size();
+
+    if (lineEnd == input.size())
+    {
+        if (input.size() > CHUNK_SIZE_LINE_MAX)
+            throw std::runtime_error("chunk size line is too long");
+        return 0;
+    }
+
+    if (digits == 0)
+        throw std::runtime_error("Invalid or empty chunk size line");
+    if (digits > 2 * sizeof(size_t))
+        throw std::runtime_error("chunk size is too large");
+
+    // after the digits only extensions (;name=value) or whitespace may follow, they are ignored
+    char next = input[digits];
+    if (next != ';' && next != '\r' && next != '\n' && next != ' ' && next != '\t')
+        throw std::runtime_error("Invalid or empty chunk size line");
+
+    size_t size = 0;
+    for (size_t i = 0; i < digits; i++)
+    {
+        char c = input[i];
+        size = (size << 4) | (c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10);
+    }
+
+    chunkRemaining = size;
+    state = size == 0 ? ChunkState::Trailers : ChunkState::Data;
+    return lineEnd + 1;
+}
+
+// one trailer field or the empty line ending the body, 0 when the line is incomplete
+size_t ChunkedDecoder::decodeTrailer(std::string_view input)
+{
+    size_t lineEnd = findByte(input.data(), input.size(), '\n');
+    if (lineEnd == input.size())
+    {
+        if (trailerBytes + input.size() > HTTP_MAX_HEADER_SIZE)
+            throw std::runtime_error("chunked trailers are larger than 1MB");
+        return 0;
+    }
+
+    std::string_view line = input.substr(0, lineEnd);
+    if (line.ends_with('\r'))
+        line.remove_suffix(1);
+
+    trailerBytes += lineEnd + 1;
+
+    if (line.empty())
+    {
+        state = ChunkState::Done;
+        return lineEnd + 1;
+    }
+
+    size_t colon = findByte(line.data(), line.size(), ':');
+    if (colon != line.size())
+        trailers.add(trimWhitespace(line.substr(0, colon)), trimWhitespace(line.substr(colon + 1)));
+
+    return lineEnd + 1;
+}
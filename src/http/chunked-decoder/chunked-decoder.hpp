@@ -0,0 +1,46 @@
+#pragma once
+
+#include "../byte-scan/byte-scan.hpp"
+#include "../header-map/header-map.hpp"
+#include "../http-parser/http-parser.hpp"
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#define CHUNK_SIZE_LINE_MAX 4096 // size line with its extensions, longer ones are rejected
+
+// where the chunked decoding stopped
+enum class ChunkState
+{
+    Size,
+    Data,
+    DataEnd,
+    Trailers,
+    Done,
+};
+
+// decodes a chunked body straight from the receive buffer. the payload is
+// handed out as views into the given bytes, nothing is copied. decode can be
+// called with any split of the body, it returns how many bytes it used and
+// the rest has to be passed again along with the bytes received next.
+class ChunkedDecoder
+{
+    ChunkState state;
+    size_t chunkRemaining; // payload bytes left of the current chunk
+    size_t trailerBytes;   // size of the trailers received so far
+    HeaderMap trailers;
+
+public:
+    ChunkedDecoder();
+
+    size_t decode(std::string_view input, const std::function<void(std::string_view)> &onPayload);
+    bool isDone() const;
+    ChunkState getState() const;
+    void reset();
+    const HeaderMap &getTrailers() const;
+
+private:
+    size_t decodeSizeLine(std::string_view input);
+    size_t decodeTrailer(std::string_view input);
+};
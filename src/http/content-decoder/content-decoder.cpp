@@ -0,0 +1,212 @@
+#include "content-decoder.hpp"
+#include "../http-parser/http-parser.hpp"
+
+ContentEncoding parseContentEncoding(std::string_view value)
+{
+    value = trimWhitespace(value);
+
+    if (value.empty() || equalsIgnoreCase(value, "identity"))
+        return ContentEncoding::Identity;
+    if (equalsIgnoreCase(value, "gzip") || equalsIgnoreCase(value, "x-gzip"))
+        return ContentEncoding::Gzip;
+    if (equalsIgnoreCase(value, "deflate"))
+        return ContentEncoding::Deflate;
+    if (equalsIgnoreCase(value, "br"))
+        return ContentEncoding::Brotli;
+
+    // stacked codings like "gzip, br" are not something we asked for
+    throw std::runtime_error("unsupported Content-Encoding: " + std::string(value));
+}
+
+ContentDecoder::ContentDecoder(ContentEncoding encoding)
+    : encoding(encoding), zlib(), zlibReady(false), rawDeflate(false), head(), brotli(nullptr),
+      output(new char[CONTENT_DECODER_BUFFER_SIZE]), ended(false), compressedBytes(0), decompressedBytes(0)
+{
+    // 32 lets zlib detect the gzip or zlib header by itself
+    if (encoding == ContentEncoding::Gzip || encoding == ContentEncoding::Deflate)
+        initZlib(15 + 32);
+    else if (encoding == ContentEncoding::Brotli)
+    {
+        brotli = BrotliDecoderCreateInstance(nullptr, nullptr, nullptr);
+        if (!brotli)
+            throw std::runtime_error("failed to create the brotli decoder");
+    }
+}
+
+ContentDecoder::~ContentDecoder()
+{
+    if (zlibReady)
+        inflateEnd(&zlib);
+    if (brotli)
+        BrotliDecoderDestroyInstance(brotli);
+}
+
+void ContentDecoder::initZlib(int windowBits)
+{
+    if (zlibReady)
+        inflateEnd(&zlib);
+
+    zlib = z_stream();
+    if (inflateInit2(&zlib, windowBits) != Z_OK)
+        throw std::runtime_error("failed to create the zlib decoder");
+    zlibReady = true;
+}
+
+// decompress the next piece of the body, output is passed on in buffer sized pieces
+void ContentDecoder::decode(std::string_view input, const std::function<void(std::string_view)> &onOutput)
+{
+    compressedBytes += input.size();
+
+    if (encoding == ContentEncoding::Identity)
+    {
+        decompressedBytes += input.size();
+        if (!input.empty())
+            onOutput(input);
+    }
+    else if (encoding == ContentEncoding::Brotli)
+        decodeBrotli(input, onOutput);
+    else if (encoding == ContentEncoding::Deflate && head.size() < 2)
+        detectDeflate(input, onOutput);
+    else
+        decodeZlib(input, onOutput);
+}
+
+// Kuch servers deflate ko bina zlib header ke bhejte hain. the first two bytes tell
+// a wrapped stream (or a mislabelled gzip one) from a raw one, they may arrive in
+// separate pieces so they are collected before anything is inflated
+void ContentDecoder::detectDeflate(std::string_view input, const std::function<void(std::string_view)> &onOutput)
+{
+    size_t take = std::min(input.size(), 2 - head.size());
+    head.append(input.substr(0, take));
+    input.remove_prefix(take);
+    if (head.size() < 2)
+        return;
+
+    unsigned char cmf = head[0], flg = head[1];
+    bool gzip = cmf == 0x1f && flg == 0x8b;
+    bool wrapped = (cmf & 0x0f) == 8 && (cmf * 256 + flg) % 31 == 0;
+    if (!gzip && !wrapped)
+    {
+        initZlib(-15);
+        rawDeflate = true;
+    }
+
+    decodeZlib(head, onOutput);
+    if (!input.empty())
+        decodeZlib(input, onOutput);
+}
+
+void ContentDecoder::decodeZlib(std::string_view input, const std::function<void(std::string_view)> &onOutput)
+{
+    zlib.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input.data()));
+    zlib.avail_in = input.size();
+
+    while (zlib.avail_in > 0)
+    {
+        // a gzip body may hold more than one member, they are decoded one after another
+        if (ended)
+        {
+            if (encoding != ContentEncoding::Gzip)
+                throw std::runtime_error("data after the end of the deflate stream");
+            inflateReset(&zlib);
+            ended = false;
+        }
+
+        zlib.next_out = reinterpret_cast<Bytef *>(output.get());
+        zlib.avail_out = CONTENT_DECODER_BUFFER_SIZE;
+
+        int result = inflate(&zlib, Z_NO_FLUSH);
+
+        if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR)
+            throw std::runtime_error(std::string("failed to decompress the body: ") + (zlib.msg ? zlib.msg : "zlib error"));
+
+        size_t produced = CONTENT_DECODER_BUFFER_SIZE - zlib.avail_out;
+        if (produced > 0)
+        {
+            decompressedBytes += produced;
+            onOutput(std::string_view(output.get(), produced));
+        }
+
+        if (result == Z_STREAM_END)
+            ended = true;
+        else if (result == Z_BUF_ERROR && produced == 0)
+            break;
+    }
+
+    // the last call may have filled the buffer exactly, drain what zlib still holds
+    while (!ended && zlib.avail_out == 0)
+    {
+        zlib.next_out = reinterpret_cast<Bytef *>(output.get());
+        zlib.avail_out = CONTENT_DECODER_BUFFER_SIZE;
+
+        int result = inflate(&zlib, Z_NO_FLUSH);
+        if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR)
+            throw std::runtime_error(std::string("failed to decompress the body: ") + (zlib.msg ? zlib.msg : "zlib error"));
+
+        size_t produced = CONTENT_DECODER_BUFFER_SIZE - zlib.avail_out;
+        if (produced > 0)
+        {
+            decompressedBytes += produced;
+            onOutput(std::string_view(output.get(), produced));
+        }
+        if (result == Z_STREAM_END)
+            ended = true;
+    }
+}
+
+void ContentDecoder::decodeBrotli(std::string_view input, const std::function<void(std::string_view)> &onOutput)
+{
+    const uint8_t *nextIn = reinterpret_cast<const uint8_t *>(input.data());
+    size_t availIn = input.size();
+
+    while (true)
+    {
+        uint8_t *nextOut = reinterpret_cast<uint8_t *>(output.get());
+        size_t availOut = CONTENT_DECODER_BUFFER_SIZE;
+
+        BrotliDecoderResult result = BrotliDecoderDecompressStream(brotli, &availIn, &nextIn, &availOut, &nextOut, nullptr);
+        if (result == BROTLI_DECODER_RESULT_ERROR)
+            throw std::runtime_error(std::string("failed to decompress the body: ") +
+                                     BrotliDecoderErrorString(BrotliDecoderGetErrorCode(brotli)));
+
+        size_t produced = CONTENT_DECODER_BUFFER_SIZE - availOut;
+        if (produced > 0)
+        {
+            decompressedBytes += produced;
+            onOutput(std::string_view(output.get(), produced));
+        }
+
+        if (result == BROTLI_DECODER_RESULT_SUCCESS)
+        {
+            ended = true;
+            if (availIn > 0)
+                throw std::runtime_error("data after the end of the brotli stream");
+            return;
+        }
+
+        // more output is pending only when the buffer got full
+        if (result == BROTLI_DECODER_RESULT_NEEDS_MORE_INPUT)
+            return;
+    }
+}
+
+void ContentDecoder::finish()
+{
+    if (encoding != ContentEncoding::Identity && !ended)
+        throw std::runtime_error("body ended in the middle of the compressed stream");
+}
+
+ContentEncoding ContentDecoder::getEncoding() const
+{
+    return encoding;
+}
+
+size_t ContentDecoder::getCompressedBytes() const
+{
+    return compressedBytes;
+}
+
+size_t ContentDecoder::getDecompressedBytes() const
+{
+    return decompressedBytes;
+}
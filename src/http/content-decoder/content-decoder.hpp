@@ -0,0 +1,60 @@
+#pragma once
+
+#include <brotli/decode.h>
+#include <zlib.h>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#define ACCEPT_ENCODING_VALUE "gzip, deflate, br" // sent when compressed responses are asked for
+#define CONTENT_DECODER_BUFFER_SIZE 65536         // 64KB ka output buffer, the only memory a stream needs
+
+// codings of a response body we know how to undo
+enum class ContentEncoding
+{
+    Identity,
+    Gzip,
+    Deflate,
+    Brotli,
+};
+
+// coding named by a Content-Encoding value, throws for codings we cant decode
+ContentEncoding parseContentEncoding(std::string_view value);
+
+// undoes the Content-Encoding of a body while it streams in. every piece of
+// input is decompressed through one fixed buffer which is handed to the
+// callback whenever it fills, so memory stays the same for any body size.
+class ContentDecoder
+{
+    ContentEncoding encoding;
+    z_stream zlib;
+    bool zlibReady;
+    bool rawDeflate; // deflate sent without the zlib wrapper, as some servers do
+    std::string head; // first bytes of a deflate body, kept till the wrapper can be told apart
+    BrotliDecoderState *brotli;
+    std::unique_ptr<char[]> output;
+    bool ended;                // the compressed stream reached its end marker
+    size_t compressedBytes;    // bytes received on the wire
+    size_t decompressedBytes;  // bytes handed to the callback
+
+public:
+    explicit ContentDecoder(ContentEncoding encoding);
+    ~ContentDecoder();
+    ContentDecoder(const ContentDecoder &) = delete;
+    ContentDecoder &operator=(const ContentDecoder &) = delete;
+
+    void decode(std::string_view input, const std::function<void(std::string_view)> &onOutput);
+    void finish(); // throws when the body ended in the middle of the compressed stream
+
+    ContentEncoding getEncoding() const;
+    size_t getCompressedBytes() const;
+    size_t getDecompressedBytes() const;
+
+private:
+    void initZlib(int windowBits);
+    void detectDeflate(std::string_view input, const std::function<void(std::string_view)> &onOutput);
+    void decodeZlib(std::string_view input, const std::function<void(std::string_view)> &onOutput);
+    void decodeBrotli(std::string_view input, const std::function<void(std::string_view)> &onOutput);
+};
@@ -0,0 +1,137 @@
+#include "header-map.hpp"
+
+HeaderMap::HeaderMap() : storage(), fields() {}
+
+HeaderMap::HeaderMap(std::initializer_list<std::pair<std::string_view, std::string_view>> headers)
+    : storage(), fields()
+{
+    size_t bytes = 0;
+    for (const auto &[name, value] : headers)
+        bytes += name.size() + value.size();
+    storage.reserve(bytes);
+
+    for (const auto &[name, value] : headers)
+        set(name, value);
+}
+
+std::string_view HeaderMap::get(std::string_view name) const
+{
+    return get(HeaderName(name));
+}
+
+std::string_view HeaderMap::get(const HeaderName &name) const
+{
+    int index = find(name.name, name.hash);
+    return index < 0 ? std::string_view() : valueAt(index);
+}
+
+bool HeaderMap::contains(std::string_view name) const
+{
+    return find(name, hashHeaderName(name)) >= 0;
+}
+
+// a replaced value stays in the storage unused, the field points at the new one
+void HeaderMap::set(std::string_view name, std::string_view value)
+{
+    int index = find(name, hashHeaderName(name));
+    if (index < 0)
+    {
+        add(name, value);
+        return;
+    }
+
+    Field &field = fields[index];
+    if (value.size() <= field.valueLength)
+    {
+        storage.replace(field.valueOffset, value.size(), value);
+        field.valueLength = value.size();
+        return;
+    }
+
+    field.valueOffset = storage.size();
+    field.valueLength = value.size();
+    storage.append(value);
+}
+
+void HeaderMap::add(std::string_view name, std::string_view value)
+{
+    fields.push_back(store(name, value));
+}
+
+bool HeaderMap::remove(std::string_view name)
+{
+    int index = find(name, hashHeaderName(name));
+    if (index < 0)
+        return false;
+
+    fields.erase(index);
+    return true;
+}
+
+void HeaderMap::clear()
+{
+    storage.clear();
+    fields.clear();
+}
+
+void HeaderMap::assign(std::string_view lines, const std::vector<HeaderSpan> &spans)
+{
+    storage.assign(lines);
+    fields.clear();
+    fields.reserve(spans.size());
+
+    for (const HeaderSpan &span : spans)
+    {
+        std::string_view name = lines.substr(span.nameOffset, span.nameLength);
+        fields.push_back({hashHeaderName(name), span.nameOffset, span.nameLength, span.valueOffset, span.valueLength});
+    }
+}
+
+size_t HeaderMap::size() const
+{
+    return fields.size();
+}
+
+bool HeaderMap::empty() const
+{
+    return fields.empty();
+}
+
+std::string_view HeaderMap::nameAt(size_t index) const
+{
+    return std::string_view(storage).substr(fields[index].nameOffset, fields[index].nameLength);
+}
+
+std::string_view HeaderMap::valueAt(size_t index) const
+{
+    return std::string_view(storage).substr(fields[index].valueOffset, fields[index].valueLength);
+}
+
+void HeaderMap::appendTo(std::string &out) const
+{
+    for (size_t i = 0; i < fields.size(); i++)
+        out.append(nameAt(i)).append(": ").append(valueAt(i)).append("\r\n");
+}
+
+// hashes are compared first, the names only when they match
+int HeaderMap::find(std::string_view name, uint32_t hash) const
+{
+    for (size_t i = 0; i < fields.size(); i++)
+        if (fields[i].hash == hash && equalsIgnoreCase(nameAt(i), name))
+            return i;
+
+    return -1;
+}
+
+HeaderMap::Field HeaderMap::store(std::string_view name, std::string_view value)
+{
+    Field field;
+    field.hash = hashHeaderName(name);
+    field.nameOffset = storage.size();
+    field.nameLength = name.size();
+    storage.append(name);
+    field.valueOffset = storage.size();
+    field.valueLength = value.size();
+    storage.append(value);
+    return field;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "../../buffer/small-vector/small-vector.hpp"
+#include "../http-parser/http-parser.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#define HEADER_MAP_INLINE_FIELDS 16 // itne fields tak koi heap allocation nahi
+
+// FNV-1a over the lowercased name, equal for names differing only in case
+constexpr uint32_t hashHeaderName(std::string_view name)
+{
+    uint32_t hash = 2166136261u;
+    for (char c : name)
+    {
+        if (c >= 'A' && c <= 'Z')
+            c = c - 'A' + 'a';
+        hash = (hash ^ (unsigned char)c) * 16777619u;
+    }
+    return hash;
+}
+
+// a header name whose hash is computed at compile time
+struct HeaderName
+{
+    std::string_view name;
+    uint32_t hash;
+
+    constexpr HeaderName(std::string_view name) : name(name), hash(hashHeaderName(name)) {}
+};
+
+// headers the downloader looks at on every response
+namespace Headers
+{
+    inline constexpr HeaderName AcceptEncoding{"Accept-Encoding"};
+    inline constexpr HeaderName AcceptRanges{"Accept-Ranges"};
+    inline constexpr HeaderName Connection{"Connection"};
+    inline constexpr HeaderName ContentDisposition{"Content-Disposition"};
+    inline constexpr HeaderName ContentEncoding{"Content-Encoding"};
+    inline constexpr HeaderName ContentLength{"Content-Length"};
+    inline constexpr HeaderName ContentRange{"Content-Range"};
+    inline constexpr HeaderName ContentType{"Content-Type"};
+    inline constexpr HeaderName Digest{"Digest"};
+    inline constexpr HeaderName ETag{"ETag"};
+    inline constexpr HeaderName Host{"Host"};
+    inline constexpr HeaderName LastModified{"Last-Modified"};
+    inline constexpr HeaderName ReprDigest{"Repr-Digest"};
+    inline constexpr HeaderName TransferEncoding{"Transfer-Encoding"};
+}
+
+// header fields in insertion order. names and values live back to back in one
+// string, the fields are offsets into it kept in a small vector, so a typical
+// response needs a single allocation. lookups ignore the case of the name.
+class HeaderMap
+{
+    struct Field
+    {
+        uint32_t hash;
+        uint32_t nameOffset;
+        uint32_t nameLength;
+        uint32_t valueOffset;
+        uint32_t valueLength;
+    };
+
+    std::string storage;
+    SmallVector<Field, HEADER_MAP_INLINE_FIELDS> fields;
+
+public:
+    HeaderMap();
+    HeaderMap(std::initializer_list<std::pair<std::string_view, std::string_view>> headers);
+
+    // empty when the header is missing, the view lives till the map changes
+    std::string_view get(std::string_view name) const;
+    std::string_view get(const HeaderName &name) const;
+    bool contains(std::string_view name) const;
+
+    void set(std::string_view name, std::string_view value); // replaces the first field with the name
+    void add(std::string_view name, std::string_view value); // keeps fields with the same name
+    bool remove(std::string_view name);
+    void clear();
+
+    // take the fields of a parsed response with one copy of its header lines
+    void assign(std::string_view lines, const std::vector<HeaderSpan> &spans);
+
+    size_t size() const;
+    bool empty() const;
+    std::string_view nameAt(size_t index) const;
+    std::string_view valueAt(size_t index) const;
+
+    void appendTo(std::string &out) const; // "name: value\r\n" per field in insertion order
+
+private:
+    int find(std::string_view name, uint32_t hash) const;
+    Field store(std::string_view name, std::string_view value);
+};
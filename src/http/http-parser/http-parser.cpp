@@ -0,0 +1,200 @@
+#include "http-parser.hpp"
+
+HttpResponseParser::HttpResponseParser()
+    : data(), scanned(0), statusParsed(false), complete(false), headersStart(0), headersEnd(0), headerSize(0),
+      versionOffset(0), versionLength(0), statusCode(0), reasonOffset(0), reasonLength(0), fields()
+{
+    fields.reserve(32);
+}
+
+bool HttpResponseParser::parse(std::string_view received)
+{
+    data = received;
+
+    while (!complete)
+    {
+        const char *start = data.data() + scanned;
+        size_t remaining = data.size() - scanned;
+
+        // one pass finds both the colon and the line end of a field
+        size_t pos = statusParsed ? findAnyOf(start, remaining, ':', '\n') : findByte(start, remaining, '\n');
+        size_t colon = std::string_view::npos;
+
+        if (pos < remaining && start[pos] == ':')
+        {
+            colon = scanned + pos;
+            pos += findByte(start + pos, remaining - pos, '\n');
+        }
+
+        // the line is not complete yet, wait for more bytes
+        if (pos == remaining)
+        {
+            if (data.size() > HTTP_MAX_HEADER_SIZE)
+                throw std::runtime_error("response headers are larger than 1MB");
+            return false;
+        }
+
+        size_t lineEnd = scanned + pos;       // position of \n
+        size_t contentEnd = lineEnd;          // without the \r before it
+        if (contentEnd > scanned && data[contentEnd - 1] == '\r')
+            contentEnd--;
+
+        if (!statusParsed)
+        {
+            std::string_view version, reason;
+            parseStatusLine(data.substr(scanned, contentEnd - scanned), version, statusCode, reason);
+
+            versionOffset = version.data() - data.data();
+            versionLength = version.size();
+            reasonOffset = reason.empty() ? 0 : reason.data() - data.data();
+            reasonLength = reason.size();
+            statusParsed = true;
+            headersStart = lineEnd + 1;
+        }
+
+        // empty line ends the headers
+        else if (contentEnd == scanned)
+        {
+            headersEnd = scanned;
+            headerSize = lineEnd + 1;
+            complete = true;
+        }
+
+        // obsolete line folding continues the previous value
+        else if (data[scanned] == ' ' || data[scanned] == '\t')
+        {
+            if (!fields.empty())
+                fields.back().valueLength = contentEnd - headersStart - fields.back().valueOffset;
+        }
+
+        // lines without a colon carry no field and are skipped
+        else if (colon != std::string_view::npos)
+            parseField(scanned, colon, contentEnd);
+
+        scanned = lineEnd + 1;
+    }
+
+    return true;
+}
+
+void HttpResponseParser::reset()
+{
+    data = std::string_view();
+    scanned = 0;
+    statusParsed = false;
+    complete = false;
+    headersStart = 0;
+    headersEnd = 0;
+    headerSize = 0;
+    versionOffset = 0;
+    versionLength = 0;
+    statusCode = 0;
+    reasonOffset = 0;
+    reasonLength = 0;
+    fields.clear();
+}
+
+bool HttpResponseParser::isComplete() const
+{
+    return complete;
+}
+
+size_t HttpResponseParser::getHeaderSize() const
+{
+    return headerSize;
+}
+
+std::string_view HttpResponseParser::getVersion() const
+{
+    return data.substr(versionOffset, versionLength);
+}
+
+int HttpResponseParser::getStatusCode() const
+{
+    return statusCode;
+}
+
+std::string_view HttpResponseParser::getReason() const
+{
+    return data.substr(reasonOffset, reasonLength);
+}
+
+std::string_view HttpResponseParser::getHeaderLines() const
+{
+    return data.substr(headersStart, headersEnd - headersStart);
+}
+
+const std::vector<HeaderSpan> &HttpResponseParser::getFields() const
+{
+    return fields;
+}
+
+// value of the first field with the name, field names are case insensitive
+std::string_view HttpResponseParser::getHeader(std::string_view name) const
+{
+    std::string_view lines = getHeaderLines();
+
+    for (const HeaderSpan &field : fields)
+        if (equalsIgnoreCase(lines.substr(field.nameOffset, field.nameLength), name))
+            return lines.substr(field.valueOffset, field.valueLength);
+
+    return std::string_view();
+}
+
+// split "HTTP/1.1 200 OK" into its parts, the reason may be empty
+void HttpResponseParser::parseStatusLine(std::string_view line, std::string_view &version, int &statusCode,
+                                         std::string_view &reason)
+{
+    size_t space = line.find(' ');
+    if (!line.starts_with("HTTP/") || space == std::string_view::npos || line.size() < space + 4)
+        throw std::runtime_error("invalid status line: " + std::string(line));
+
+    version = line.substr(0, space);
+
+    const char *codeStart = line.data() + space + 1;
+    auto [end, ec] = std::from_chars(codeStart, codeStart + 3, statusCode);
+    if (ec != std::errc() || end != codeStart + 3)
+        throw std::runtime_error("invalid status code in: " + std::string(line));
+
+    reason = line.size() > space + 5 ? line.substr(space + 5) : std::string_view();
+}
+
+// remember the name and the trimmed value of a field line
+void HttpResponseParser::parseField(size_t lineStart, size_t colon, size_t lineEnd)
+{
+    std::string_view name = data.substr(lineStart, colon - lineStart);
+    std::string_view value = trimWhitespace(data.substr(colon + 1, lineEnd - colon - 1));
+
+    // a name never ends with whitespace, tolerate it anyway
+    name = trimWhitespace(name);
+
+    const char *base = data.data() + headersStart;
+    fields.push_back({(uint32_t)(name.data() - base), (uint32_t)name.size(),
+                      (uint32_t)(value.data() - base), (uint32_t)value.size()});
+}
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b)
+{
+    if (a.size() != b.size())
+        return false;
+
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        // ASCII letters differ only in the 0x20 bit
+        char x = a[i], y = b[i];
+        if (x != y && ((x | 0x20) != (y | 0x20) || (x | 0x20) < 'a' || (x | 0x20) > 'z'))
+            return false;
+    }
+    return true;
+}
+
+// drop spaces and tabs around a value
+std::string_view trimWhitespace(std::string_view value)
+{
+    size_t first = value.find_first_not_of(" \t");
+    if (first == std::string_view::npos)
+        return std::string_view(value.data() + value.size(), 0);
+
+    size_t last = value.find_last_not_of(" \t");
+    return value.substr(first, last - first + 1);
+}
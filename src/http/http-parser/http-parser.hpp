@@ -0,0 +1,67 @@
+#pragma once
+
+#include "../byte-scan/byte-scan.hpp"
+#include <charconv>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#define HTTP_MAX_HEADER_SIZE (1024 * 1024) // headers bigger than 1MB are treated as a broken response
+
+// a header field as offsets into the header lines, so it stays valid when the
+// lines are copied or the receive buffer moves
+struct HeaderSpan
+{
+    uint32_t nameOffset;
+    uint32_t nameLength;
+    uint32_t valueOffset;
+    uint32_t valueLength;
+};
+
+// parses the status line and headers of a response as the bytes arrive. every
+// call gets all bytes received so far starting at the status line, scanning
+// continues where the previous call stopped. nothing is copied, fields are
+// spans over the given bytes.
+class HttpResponseParser
+{
+    std::string_view data;    // bytes of the last parse call
+    size_t scanned;           // bytes of the complete lines handled so far
+    bool statusParsed;
+    bool complete;
+    size_t headersStart;      // first byte after the status line
+    size_t headersEnd;        // first byte of the empty line ending the headers
+    size_t headerSize;        // status line, headers and the empty line
+    size_t versionOffset;     // the status line parts as offsets into data too,
+    size_t versionLength;     // the buffer may move before they are read
+    int statusCode;
+    size_t reasonOffset;
+    size_t reasonLength;
+    std::vector<HeaderSpan> fields;
+
+public:
+    HttpResponseParser();
+
+    // true once the empty line after the headers was seen
+    bool parse(std::string_view received);
+    void reset();
+
+    bool isComplete() const;
+    size_t getHeaderSize() const; // the body starts after these many bytes
+    std::string_view getVersion() const;
+    int getStatusCode() const;
+    std::string_view getReason() const;
+    std::string_view getHeaderLines() const;          // header lines without the status and the empty line
+    const std::vector<HeaderSpan> &getFields() const; // spans into getHeaderLines
+    std::string_view getHeader(std::string_view name) const;
+
+    static void parseStatusLine(std::string_view line, std::string_view &version, int &statusCode,
+                                std::string_view &reason);
+
+private:
+    void parseField(size_t lineStart, size_t colon, size_t lineEnd);
+};
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b);
+std::string_view trimWhitespace(std::string_view value);
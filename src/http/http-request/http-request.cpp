@@ -5,29 +5,39 @@ HttpRequest::HttpRequest()
     : method("GET"),
       path("/"),
       version("HTTP/1.1"),
-      headers(std::unordered_map<std::string, std::string>()) {}
+      headers() {}
 
 // create a HttpRequest object from the provided params
 HttpRequest::HttpRequest(const std::string &m,
                          const std::string &p,
                          const std::string &v,
-                         const std::unordered_map<std::string, std::string> &h)
+                         const HeaderMap &h)
     : method(m),
       path(p), version(v), headers(h)
 {
 }
 
-// stringify the HttpRequest object
+// set a header of the request, replaces the existing value
+void HttpRequest::setHeader(const std::pair<std::string_view, std::string_view> &header)
+{
+    this->headers.set(header.first, header.second);
+}
+
+// get the header value if found, fallback to empty
+std::string_view HttpRequest::getHeader(std::string_view key) const
+{
+    return this->headers.get(key);
+}
+
+// stringify the HttpRequest object, headers go out in the order they were set
 std::string HttpRequest::toString() const
 {
-    std::ostringstream oss;
-    oss << method << " " << path << " " << version << "\r\n";
-    for (const auto &[key, value] : headers)
-    {
-        oss << key << ": " << value << "\r\n";
-    }
-    oss << "\r\n";
-    return oss.str();
+    std::string request;
+    request.reserve(256);
+    request.append(method).append(" ").append(path).append(" ").append(version).append("\r\n");
+    headers.appendTo(request);
+    request.append("\r\n");
+    return request;
 }
 
 // parse the requestBuffer into HttpRequest object
@@ -52,13 +62,30 @@ HttpRequest HttpRequest::parse(const std::string &requestBuffer)
             std::string value = line.substr(colon + 1);
             // remove leading space or tab
             value.erase(0, value.find_first_not_of(" \t\r\n"));
-            req.headers[key] = value;
+            req.headers.set(key, value);
         }
     }
 
     return req;
 }
 
+// create the GET request we send for downloading a resource
+HttpRequest HttpRequest::makeGetRequest(const std::string &host, const std::string &path, bool keepAlive)
+{
+    return HttpRequest(
+        "GET", path, "HTTP/1.1",
+        {{"Accept", "*/*"},
+         {"Host", host},
+         {"User-Agent",
+          "Mozilla/5.0 "
+          "(Windows NT 10.0; Win64; x64) "
+          "AppleWebKit/537.36 "
+          "(KHTML, like Gecko) "
+          "Chrome/91.0.4472.124 "
+          "Safari/537.36"},
+         {"Connection", keepAlive ? "keep-alive" : "close"}});
+}
+
 HttpRequest::~HttpRequest()
 {
     // std::cout << "requets object being freed" << std::endl;
@@ -1,7 +1,7 @@
 #pragma once 
 
+#include "../header-map/header-map.hpp"
 #include <string>
-#include <unordered_map>
 #include <sstream>
 
 class HttpRequest
@@ -9,15 +9,18 @@ class HttpRequest
     std::string method;
     std::string path;
     std::string version;
-    std::unordered_map<std::string, std::string> headers;
+    HeaderMap headers;
 
 public:
     HttpRequest();
     HttpRequest(const std::string &method,
                 const std::string &path,
                 const std::string &version,
-                const std::unordered_map<std::string, std::string> &headers);
+                const HeaderMap &headers);
     ~HttpRequest();
+    void setHeader(const std::pair<std::string_view, std::string_view> &header);
+    std::string_view getHeader(std::string_view key) const;
     std::string toString() const;
     static HttpRequest parse(const std::string &requestBuffer);
+    static HttpRequest makeGetRequest(const std::string &host, const std::string &path, bool keepAlive = false);
 };
@@ -1,27 +1,49 @@
 #include "http-response.hpp"
+#include <algorithm>
 
 // create HttpResponse object from default values
 HttpResponse::HttpResponse()
     : version("HTTP/1.1"),
       statusCode(200),
       statusMessage("OK"),
-      headers(std::unordered_map<std::string, std::string>()),
+      headers(),
       body("") {}
 
 // create HttpResponse object from provided values
 HttpResponse::HttpResponse(const std::string &ver,
                            const int sc,
                            const std::string &sm,
-                           const std::unordered_map<std::string, std::string> &hdr,
+                           const HeaderMap &hdr,
                            const std::string &bdy)
     : version(ver), statusCode(sc), statusMessage(sm), headers(hdr), body(bdy) {}
 
-// get the header value if found, fallback to empty string
-std::string HttpResponse::getHeader(const std::string &key)
+// get the header value if found, fallback to empty
+std::string_view HttpResponse::getHeader(std::string_view key) const
 {
-    auto it = this->headers.find(key);
+    return this->headers.get(key);
+}
+
+// same with the hash of a well known name computed at compile time
+std::string_view HttpResponse::getHeader(const HeaderName &key) const
+{
+    return this->headers.get(key);
+}
+
+// HTTP/1.1 connections stay open unless the server says close
+bool HttpResponse::keepsAlive() const
+{
+    std::string connection(headers.get(Headers::Connection));
+    std::transform(connection.begin(), connection.end(), connection.begin(), ::tolower);
 
-    return it == this->headers.end() ? "" : it->second;
+    if (version == "HTTP/1.1")
+        return connection.find("close") == std::string::npos;
+    return connection.find("keep-alive") != std::string::npos;
+}
+
+// get the status code of the response
+int HttpResponse::getStatusCode() const
+{
+    return this->statusCode;
 }
 
 // get the content of the response
@@ -35,9 +57,9 @@ std::string HttpResponse::toString() const
 {
     std::ostringstream oss;
     oss << this->version << " " << this->statusCode << " " << this->statusMessage << "\r\n";
-    for (const auto &[key, value] : headers)
+    for (size_t i = 0; i < headers.size(); i++)
     {
-        oss << key << ": " << value << "\r\n";
+        oss << headers.nameAt(i) << ": " << headers.valueAt(i) << "\r\n";
     }
     oss << "\r\n";
     oss << this->body;
@@ -50,56 +72,45 @@ void HttpResponse::setContent(const std::string &body)
     this->body = body;
 }
 
-// set the HttpResponse object header
-void HttpResponse::setHeader(const std::pair<std::string, std::string> &header)
+// set the HttpResponse object header, replaces a field with the same name
+void HttpResponse::setHeader(const std::pair<std::string_view, std::string_view> &header)
 {
-    this->headers[header.first] = header.second;
+    this->headers.set(header.first, header.second);
 }
 
 // set the headers of the HttpResponse object
-void HttpResponse::setHeaders(const std::unordered_map<std::string, std::string> &headers)
+void HttpResponse::setHeaders(const HeaderMap &headers)
 {
     this->headers = headers;
 }
 
+// take the status line and headers of a parsed response, one copy of the whole block
+void HttpResponse::assign(const HttpResponseParser &parser)
+{
+    version.assign(parser.getVersion());
+    statusCode = parser.getStatusCode();
+    statusMessage.assign(parser.getReason());
+    headers.assign(parser.getHeaderLines(), parser.getFields());
+}
+
 // parse the response buffer into object
 HttpResponse HttpResponse::parse(const std::string &responseBuffer)
 {
     HttpResponse res;
-    std::istringstream stream(responseBuffer);
-    std::string line;
-
-    // Status line
-    std::getline(stream, line);
-    std::istringstream statusLine(line);
-    statusLine >> res.version >> res.statusCode;
-    std::getline(statusLine, res.statusMessage); // Rest of the line
-
-    if (!res.statusMessage.empty() && res.statusMessage.back() == '\r')
-        res.statusMessage.pop_back();
+    HttpResponseParser parser;
 
-    // Headers
-    while (std::getline(stream, line) && line != "\r")
+    // a response without the empty line has no body yet
+    if (!parser.parse(responseBuffer))
     {
-        auto colon = line.find(':');
-        if (colon != std::string::npos)
-        {
-            std::string key = line.substr(0, colon);
-            std::string value = line.substr(colon + 1);
-
-            // triming leading spaces
-            key.erase(0, key.find_first_not_of(" \t\r\n"));
-            value.erase(0, value.find_first_not_of(" \t\r\n"));
-
-            res.headers[key] = value;
-        }
+        // the parser only keeps views, the padded copy has to outlive assign
+        std::string padded = responseBuffer + "\r\n\r\n";
+        parser.parse(padded);
+        res.assign(parser);
+        return res;
     }
 
-    // Body (if any)
-    std::ostringstream bodyStream;
-    bodyStream << stream.rdbuf(); // Remaining part of stream
-    res.body = bodyStream.str();
-
+    res.assign(parser);
+    res.body = responseBuffer.substr(parser.getHeaderSize());
     return res;
 }
 
@@ -108,53 +119,45 @@ void HttpResponse::parseStatusLine(const std::string &responseBuffer)
 {
     if (responseBuffer.starts_with("HTTP/"))
     {
-        std::istringstream stream(responseBuffer);
-        std::string line;
-
-        // Status line
-        std::getline(stream, line);
-        std::istringstream statusLine(line);
-        statusLine >> version >> statusCode;
-        std::getline(statusLine, statusMessage); // Rest of the line
-
-        if (!statusMessage.empty() && statusMessage.back() == '\r')
-            statusMessage.pop_back();
+        std::string_view line(responseBuffer);
+        line = line.substr(0, findByte(line.data(), line.size(), '\n'));
+        if (line.ends_with('\r'))
+            line.remove_suffix(1);
+
+        std::string_view ver, reason;
+        HttpResponseParser::parseStatusLine(line, ver, statusCode, reason);
+        version.assign(ver);
+        statusMessage.assign(reason);
     }
 }
 
 // get a map of headers
-std::unordered_map<std::string, std::string> HttpResponse::parseHeaders(const std::string &responseBuffer)
+HeaderMap HttpResponse::parseHeaders(const std::string &responseBuffer)
 {
-    size_t headersStart = responseBuffer.find("\r\n");
-
-    // when no header is present then return empty map
-    if (headersStart == std::string::npos)
-        return std::unordered_map<std::string, std::string>();
+    HeaderMap headers;
+    std::string_view rest(responseBuffer);
 
     // when status line is present then skip it
-    if (responseBuffer.starts_with("HTTP/1.1"))
-        headersStart = headersStart + 2;
-    else
-        headersStart = 0;
-
-    std::unordered_map<std::string, std::string> headers;
+    if (rest.starts_with("HTTP/"))
+    {
+        size_t statusEnd = findByte(rest.data(), rest.size(), '\n');
+        rest.remove_prefix(std::min(statusEnd + 1, rest.size()));
+    }
 
-    std::istringstream stream(responseBuffer);
-    std::string line;
-    while (std::getline(stream, line) && line != "\r")
+    while (!rest.empty())
     {
-        size_t colonPos = line.find(':');
-        if (colonPos != std::string::npos)
-        {
-            std::string key = line.substr(0, colonPos);
-            std::string value = line.substr(colonPos + 1);
-
-            // triming leading spaces
-            key.erase(0, key.find_first_not_of(" \t\r\n"));
-            value.erase(0, value.find_first_not_of(" \t\r\n"));
-
-            headers[key] = value;
-        }
+        size_t lineEnd = findByte(rest.data(), rest.size(), '\n');
+        std::string_view line = rest.substr(0, lineEnd);
+        rest.remove_prefix(std::min(lineEnd + 1, rest.size()));
+
+        if (line.ends_with('\r'))
+            line.remove_suffix(1);
+        if (line.empty())
+            break;
+
+        size_t colonPos = findByte(line.data(), line.size(), ':');
+        if (colonPos != line.size())
+            headers.set(trimWhitespace(line.substr(0, colonPos)), trimWhitespace(line.substr(colonPos + 1)));
     }
     return headers;
 }
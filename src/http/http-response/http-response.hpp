@@ -1,7 +1,9 @@
 #pragma once
 
+#include "../header-map/header-map.hpp"
+#include "../http-parser/http-parser.hpp"
 #include <string>
-#include <unordered_map>
+#include <string_view>
 #include <sstream>
 #include <iostream>
 
@@ -10,7 +12,7 @@ class HttpResponse
     std::string version;
     int statusCode;
     std::string statusMessage;
-    std::unordered_map<std::string, std::string> headers;
+    HeaderMap headers;
     std::string body;
 
 public:
@@ -19,17 +21,21 @@ public:
         const std::string &ver,
         const int sc,
         const std::string &sm,
-        const std::unordered_map<std::string, std::string> &headers,
+        const HeaderMap &headers,
         const std::string &body);
     ~HttpResponse();
-    std::string getHeader(const std::string &key);
+    std::string_view getHeader(std::string_view key) const; // empty when missing, valid till the headers change
+    std::string_view getHeader(const HeaderName &key) const;
+    int getStatusCode() const;
+    bool keepsAlive() const; // the server allows another request on this connection
     std::string getContent();
     std::string toString() const;
-    void setHeader(const std::pair<std::string, std::string> &header);
-    void setHeaders(const std::unordered_map<std::string, std::string> &headers);
+    void setHeader(const std::pair<std::string_view, std::string_view> &header);
+    void setHeaders(const HeaderMap &headers);
     void setContent(const std::string &body);
+    void assign(const HttpResponseParser &parser); // copy a parsed status line and headers
     static HttpResponse parse(const std::string &responseBuffer);
     void parseStatusLine(const std::string &responseBuffer);
-    static std::unordered_map<std::string, std::string> parseHeaders(const std::string &data);
+    static HeaderMap parseHeaders(const std::string &data);
     static std::string parseBody(const std::string &responseBuffer);
 };
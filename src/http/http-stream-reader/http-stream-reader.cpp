@@ -2,49 +2,90 @@
 
 // create a HttpStreamReader with provided socket
 HttpStreamReader::HttpStreamReader(std::shared_ptr<ISocket> sock)
-    : socket(sock), preBuffer("") {}
+    : socket(sock), buffer(), parser(), logProgress(true), limiter(nullptr), throttleDelay(0),
+      framing(BodyFraming::UntilClose), bodyRemaining(0), chunked() {}
 
-// read only the headers via socket
-std::string HttpStreamReader::readHeaders()
+// enable/disable logging the download status, parallel readers disable it
+void HttpStreamReader::setProgressLogging(bool enabled)
 {
-    int sizeForHeaders = 4096;
+    this->logProgress = enabled;
+}
+
+void HttpStreamReader::setRateLimiter(std::shared_ptr<RateLimiter> rateLimiter)
+{
+    this->limiter = std::move(rateLimiter);
+}
+
+std::chrono::milliseconds HttpStreamReader::getThrottleDelay() const
+{
+    return throttleDelay;
+}
+
+// bytes already received after what has been read so far
+std::string_view HttpStreamReader::getBuffered() const
+{
+    return buffer.readable();
+}
 
-    std::string data = socket->receiveSome(sizeForHeaders);
+// drop the first n buffered bytes, when someone else handled them
+void HttpStreamReader::consume(size_t n)
+{
+    buffer.consume(n);
+}
 
-    // status line end dhundho (properly find "\r\n")
-    size_t statusLineEnding = data.find("\r\n");
-    if (statusLineEnding == std::string::npos)
+// read the status line and the headers via socket, the body stays buffered
+void HttpStreamReader::readResponse(HttpResponse &res)
+{
+    // every call only scans the bytes which arrived after the previous one
+    while (!parser.parse(buffer.readable()))
     {
-        this->preBuffer += data;
-        return "";
+        if (fillBuffer() == 0)
+            throw std::runtime_error("connection closed before receiving the headers");
     }
-    statusLineEnding += 2; // move after \r\n
 
-    // headers end dhundho (properly find "\r\n\r\n")
-    size_t headersEnding = data.find("\r\n\r\n", statusLineEnding);
-    if (headersEnding == std::string::npos)
+    takeResponse(res);
+}
+
+// read the headers with whatever has arrived, without waiting for more
+IoStatus HttpStreamReader::tryReadResponse(HttpResponse &res)
+{
+    // the parser keeps its position between the calls
+    while (!parser.parse(buffer.readable()))
     {
-        this->preBuffer += data;
-        return "";
-    }
+        size_t received = 0;
+        IoStatus status = tryFillBuffer(received);
 
-    // Extract headers
-    std::string headers = data.substr(statusLineEnding, headersEnding - statusLineEnding);
+        if (status != IoStatus::Done)
+            return status;
+        if (received == 0)
+            throw std::runtime_error("connection closed before receiving the headers");
+    }
 
-    // Save body data (after \r\n\r\n)
-    this->preBuffer += data.substr(headersEnding + 4);
+    takeResponse(res);
+    return IoStatus::Done;
+}
 
-    return headers;
+// hand the parsed headers to res and drop them from the buffer
+void HttpStreamReader::takeResponse(HttpResponse &res)
+{
+    res.assign(parser);
+    buffer.consume(parser.getHeaderSize());
+    parser.reset();
 }
 
 // read only the body content via socket
 std::string HttpStreamReader::readContent(const size_t contentLength = 0, const std::function<void(const std::string &data)> &callback)
 {
-    std::string receivedData =
-        contentLength == 0 ? socket->receiveAll() : socket->receiveSome(contentLength);
+    // without a length the body lasts till the peer closes the connection
+    while (contentLength == 0 || buffer.size() < contentLength)
+    {
+        if (fillBuffer() == 0)
+            break;
+    }
 
-    // add the pre buffer in the main data
-    std::string data = preBuffer + receivedData;
+    std::string_view available = buffer.readable();
+    std::string data(contentLength == 0 ? available : available.substr(0, contentLength));
+    buffer.consume(data.size());
 
     if (callback)
     {
@@ -53,92 +94,59 @@ std::string HttpStreamReader::readContent(const size_t contentLength = 0, const
     return data;
 }
 
-// read the chunked body content and provide it to the callback
-void HttpStreamReader::readChunkedContent(const std::function<void(const std::string &data)> &onData)
+// decode the chunked body in the buffer and provide the payload to the callback
+void HttpStreamReader::readChunkedContent(const BodyCallback &onData)
 {
-    std::string accumulatedData;
+    chunked.reset();
 
     while (true)
     {
-        // get the size of the chunk
-        size_t chunkSize = getChunkSize();
+        // the payload is handed out straight from the buffer, consume only after the callback
+        size_t used = chunked.decode(buffer.readable(), onData);
+        buffer.consume(used);
 
-        // when all data is received then exit
-        if (chunkSize == 0)
-        {
-            // Sab kuch receive ho gaya
-            if (!accumulatedData.empty())
-            {
-                onData(accumulatedData);
-            }
+        if (chunked.isDone())
             break;
-        }
-
-        size_t remaining = chunkSize;
 
-        while (remaining > 0)
+        if (fillBuffer() == 0)
         {
-            // when there is no data available then receive some data
-            if (preBuffer.empty())
-            {
-                preBuffer += socket->receiveSome(FLUSH_THRESHOLD);
-            }
-
-            // take only the amount of data we can/should take
-            size_t toCopy = std::min(remaining, preBuffer.size());
-
-            // append the extracted specified amount of data
-            accumulatedData.append(preBuffer.substr(0, toCopy));
-
-            // erase the extracted data from storage and decrease the remaining data required
-            preBuffer.erase(0, toCopy);
-            remaining -= toCopy;
-
-            // if enough data available then bulk provide to the callback and clear the stored data
-            if (accumulatedData.size() >= FLUSH_THRESHOLD)
-            {
-                onData(accumulatedData);
-                accumulatedData.clear();
-            }
+            // some servers close right after the last chunk without ending the trailers
+            if (chunked.getState() == ChunkState::Trailers)
+                break;
+            throw std::runtime_error("connection closed in the middle of a chunked body");
         }
-
-        // Chunk ke data ke baad \r\n aata hai, usko discard karna padega
-        ensureCRLF();
-    }
-
-    // Last me agar kuch bach gaya accumulatedData me
-    if (!accumulatedData.empty())
-    {
-        onData(accumulatedData);
     }
 }
 
 // read the given Content-Length size data and provide it to the callback
 void HttpStreamReader::readSpecifiedChunkedContent(const size_t contentLength, const std::function<void(const std::string &data)> &callback)
 {
-    std::string data = preBuffer;
-
-    size_t remainingData = contentLength - data.size();
+    std::string data;
+    data.reserve(5 * STREAM_BUFFER_CAPACITY);
 
+    // without a length the body lasts till the peer closes the connection
+    size_t remainingData = contentLength;
     size_t noOfChunksCompleted = 0;
-    std::string receivedData = "";
 
-    // receiving data till we get empty data
-    while (!(receivedData = socket->receiveSome(FLUSH_THRESHOLD)).empty())
+    while (contentLength == 0 || remainingData > 0)
     {
+        // the bytes received along with the headers are used first
+        if (buffer.empty() && fillBuffer() == 0)
+            break;
+
         // incrementing when a chunk fetched
         noOfChunksCompleted++;
 
-        // decrease what amount of data we fetched
-        remainingData -= receivedData.size();
+        // take only the bytes belonging to this body
+        std::string_view receivedData = buffer.readable();
+        if (contentLength != 0)
+            receivedData = receivedData.substr(0, remainingData);
 
-        // adding to fetched data to our stored data
-        data = data + receivedData;
-
-        // showing the download status
-        double downloadStatus = ((contentLength - remainingData) * 1.0 / contentLength) * 100;
-        downloadStatus = round(downloadStatus * 10.0) / 10.0;
-        std::clog << "\rdownloading " << downloadStatus << "%" << std::flush;
+        // adding to fetched data to our stored data, decrease what amount of data we fetched
+        data.append(receivedData);
+        buffer.consume(receivedData.size());
+        if (contentLength != 0)
+            remainingData -= receivedData.size();
 
         // for every 5 fetched chunks we are writing to the file
         if (noOfChunksCompleted % 5 == 0)
@@ -150,11 +158,14 @@ void HttpStreamReader::readSpecifiedChunkedContent(const size_t contentLength, c
         }
     }
 
-    std::clog << "\nno of chunks we received: " << noOfChunksCompleted << std::endl;
+    if (logProgress)
+    {
+        std::clog << "no of chunks we received: " << noOfChunksCompleted << std::endl;
 
-    // if we doesnt got specified amount of data
-    if (remainingData != 0)
-        std::clog << "Data doesnt received as much as specified" << std::endl;
+        // if we doesnt got specified amount of data
+        if (remainingData != 0)
+            std::clog << "Data doesnt received as much as specified" << std::endl;
+    }
 
     // if there is  some data left then write to the file
     if (!data.empty())
@@ -162,57 +173,213 @@ void HttpStreamReader::readSpecifiedChunkedContent(const size_t contentLength, c
         callback(data);
         data.clear();
     }
+}
+
+// fill destination with the body, the buffered bytes are copied and the rest is
+// received into it directly. onData sees every filled piece in order, the
+// result is less than the destination size when the peer closed early
+size_t HttpStreamReader::readContentInto(std::span<char> destination, const BodyCallback &onData)
+{
+    std::string_view buffered = buffer.readable().substr(0, destination.size());
+    std::memcpy(destination.data(), buffered.data(), buffered.size());
+    buffer.consume(buffered.size());
+
+    size_t filled = buffered.size();
+    if (filled > 0 && onData)
+        onData(std::string_view(destination.data(), filled));
+
+    while (filled < destination.size())
+    {
+        size_t bytesRead = receive(destination.subspan(filled));
+        if (bytesRead == 0)
+            break;
+
+        if (onData)
+            onData(std::string_view(destination.data() + filled, bytesRead));
+        filled += bytesRead;
+    }
 
-    // adding empty data to prebuffer
-    preBuffer = data;
+    return filled;
 }
 
-// extract the chunk size from the chunk
-size_t HttpStreamReader::getChunkSize()
+// move the rest of a body from the socket to fileFd at position with splice(), the
+// bytes never reach user space. the caller writes what is already buffered first.
+// contentLength 0 moves bytes till the peer closes, returns the bytes moved
+size_t HttpStreamReader::spliceContent(int fileFd, size_t position, size_t contentLength)
+{
+    int socketFd = socket->getRawFd();
+    if (socketFd < 0)
+        throw std::runtime_error("the socket doesnt carry the body as is, it cant be spliced");
+
+    SplicePipe pipe;
+    size_t moved = 0;
+    Metrics &metrics = Metrics::instance();
+
+    while (contentLength == 0 || moved < contentLength)
+    {
+        size_t space = contentLength == 0 ? pipe.getCapacity() : std::min(contentLength - moved, pipe.getCapacity());
+        space = waitForAllowance(space);
+
+        size_t n = pipe.transfer(socketFd, fileFd, position + moved, space);
+        if (limiter)
+            limiter->consume(n);
+
+        metrics.add(Counter::Reads);
+        metrics.add(Counter::BytesReceived, n);
+        if (n == 0)
+            break;
+
+        metrics.add(Counter::Writes);
+        metrics.add(Counter::BytesWritten, n);
+        moved += n;
+    }
+
+    return moved;
+}
+
+// prepare reading a body with the given framing without blocking
+void HttpStreamReader::beginBody(BodyFraming bodyFraming, size_t contentLength)
+{
+    framing = bodyFraming;
+    bodyRemaining = contentLength;
+    chunked.reset();
+}
+
+// consume the body bytes which have arrived, Done once the whole body is read
+IoStatus HttpStreamReader::tryReadBody(const BodyCallback &onData)
 {
-    // take the first line from the prebuffered data chunks
-    std::string line;
     while (true)
     {
-        // find the line ending
-        auto pos = preBuffer.find('\n');
+        if (consumeBody(onData))
+            return IoStatus::Done;
 
-        // if there is a line ending then take the line and remove the line ending
-        if (pos != std::string::npos)
-        {
-            line = preBuffer.substr(0, pos + 1);
-            preBuffer.erase(0, pos + 1);
+        size_t received = 0;
+        IoStatus status = tryFillBuffer(received);
 
-            // Remove \r\n safely
-            while (!line.empty() && (line.back() == '\n' || line.back() == '\r'))
-                line.pop_back();
+        if (status != IoStatus::Done)
+            return status;
 
-            break;
+        if (received == 0)
+        {
+            // such a body ends when the peer closes
+            if (framing == BodyFraming::UntilClose)
+                return IoStatus::Done;
+            if (framing == BodyFraming::Chunked && chunked.getState() == ChunkState::Trailers)
+                return IoStatus::Done;
+            throw std::runtime_error("connection closed before the body was complete");
         }
-        preBuffer += socket->receiveSome(FLUSH_THRESHOLD);
+    }
+}
+
+// trailer fields sent after the last chunk
+const HeaderMap &HttpStreamReader::getTrailers() const
+{
+    return chunked.getTrailers();
+}
+
+// hand the buffered body bytes to the callback, true once the body is complete
+bool HttpStreamReader::consumeBody(const BodyCallback &onData)
+{
+    if (framing == BodyFraming::Chunked)
+    {
+        buffer.consume(chunked.decode(buffer.readable(), onData));
+        return chunked.isDone();
     }
 
-    // if there is no line
-    if (line.empty())
-        throw std::runtime_error("Invalid or empty chunk size line");
+    std::string_view data = buffer.readable();
+    if (framing == BodyFraming::ContentLength)
+        data = data.substr(0, bodyRemaining);
 
-    // convert the stringified hexadecimal number to decimal number
-    return std::stoul(line, nullptr, 16);
+    if (!data.empty())
+        onData(data);
+    buffer.consume(data.size());
+
+    if (framing == BodyFraming::ContentLength)
+    {
+        bodyRemaining -= data.size();
+        return bodyRemaining == 0;
+    }
+    return false;
 }
 
-// will remove the CRLF("\r\n") from the chunk
-void HttpStreamReader::ensureCRLF()
+// receive what is available into the buffer without waiting
+IoStatus HttpStreamReader::tryFillBuffer(size_t &received)
 {
-    // when chunk data ending not available then receive some data for it
-    while (preBuffer.size() < 2)
+    // a header block can outgrow the buffer
+    if (buffer.writable() == 0)
+        buffer.reserve(STREAM_BUFFER_CAPACITY);
+
+    size_t space = buffer.writable();
+
+    // over the rate limit the caller waits on a timer instead of the socket
+    if (limiter)
     {
-        preBuffer += socket->receiveSome(FLUSH_THRESHOLD);
+        space = limiter->allowance(space);
+        if (space == 0)
+        {
+            received = 0;
+            throttleDelay = limiter->delay(buffer.writable());
+            Metrics::instance().add(Counter::ReadThrottled);
+            return IoStatus::WantTime;
+        }
     }
 
-    // remove the chunked data ending
-    if (preBuffer.substr(0, 2) != "\r\n")
+    IoStatus status = socket->tryReceive(std::span<char>(buffer.writePtr(), space), received);
+    buffer.commit(received);
+
+    if (limiter)
+        limiter->consume(received);
+
+    Metrics &metrics = Metrics::instance();
+    metrics.add(Counter::Reads);
+    metrics.add(Counter::BytesReceived, received);
+    if (status != IoStatus::Done)
+        metrics.add(Counter::ReadWaits);
+    return status;
+}
+
+// receive more bytes after the unread ones, 0 when the peer closed the connection
+size_t HttpStreamReader::fillBuffer()
+{
+    // a header block can outgrow the buffer
+    if (buffer.writable() == 0)
+        buffer.reserve(STREAM_BUFFER_CAPACITY);
+
+    // writable() may compact the buffer so it has to be taken before the pointer
+    size_t space = buffer.writable();
+
+    size_t bytesRead = receive(std::span<char>(buffer.writePtr(), space));
+    buffer.commit(bytesRead);
+    return bytesRead;
+}
+
+// a blocking receive into destination within the rate limit, 0 when the peer closed the connection
+size_t HttpStreamReader::receive(std::span<char> destination)
+{
+    size_t space = waitForAllowance(destination.size());
+    size_t bytesRead = socket->receiveInto(destination.first(space));
+
+    if (limiter)
+        limiter->consume(bytesRead);
+
+    Metrics &metrics = Metrics::instance();
+    metrics.add(Counter::Reads);
+    metrics.add(Counter::BytesReceived, bytesRead);
+    return bytesRead;
+}
+
+// bytes the next blocking read may take, sleeps while the rate limit is used up
+size_t HttpStreamReader::waitForAllowance(size_t space)
+{
+    // Limit khatam ho gayi to thoda ruk jao
+    while (limiter)
     {
-        throw std::runtime_error("Expected CRLF after chunk data");
+        size_t allowed = limiter->allowance(space);
+        if (allowed > 0)
+            return allowed;
+
+        Metrics::instance().add(Counter::ReadThrottled);
+        std::this_thread::sleep_for(limiter->delay(space));
     }
-    preBuffer.erase(0, 2);
+    return space;
 }
@@ -1,26 +1,72 @@
 #pragma once
 
 #include "../../socket-lib/isocket/isocket.hpp"
+#include "../../buffer/stream-buffer/stream-buffer.hpp"
+#include "../../io/splice-pipe/splice-pipe.hpp"
+#include "../../metrics/transfer-metrics/transfer-metrics.hpp"
+#include "../../socket-lib/rate-limiter/rate-limiter.hpp"
+#include "../chunked-decoder/chunked-decoder.hpp"
+#include "../http-parser/http-parser.hpp"
+#include "../http-response/http-response.hpp"
+#include <charconv>
+#include <cstring>
 #include <memory>
 #include <functional>
 #include <iostream>
 #include <math.h>
 #include <thread>
 
-#define FLUSH_THRESHOLD 8192 // 8KB ka threshold flush karne ke liye
+// how the end of a body is found
+enum class BodyFraming
+{
+    ContentLength,
+    Chunked,
+    UntilClose,
+};
+
+// receives body bytes as views into the receive buffer, valid only during the call
+using BodyCallback = std::function<void(std::string_view data)>;
 
 class HttpStreamReader
 {
     std::shared_ptr<ISocket> socket; // TCP/SSl socket
-    std::string preBuffer;
+    StreamBuffer buffer;             // received but not yet consumed bytes
+    HttpResponseParser parser;       // resumes scanning the headers as more bytes arrive
+    bool logProgress;                // whether a summary is logged after reading a body
+    std::shared_ptr<RateLimiter> limiter;  // every receive takes its bytes from here, nullptr for no limit
+    std::chrono::milliseconds throttleDelay; // how long a WantTime read has to wait
+
+    // state of the non-blocking body reading
+    BodyFraming framing;
+    size_t bodyRemaining;   // bytes left of a Content-Length body
+    ChunkedDecoder chunked; // framing of a chunked body, used by both reading modes
 
 public:
     HttpStreamReader(std::shared_ptr<ISocket> sock);
-    std::string readHeaders();                                                                                                   // reads only the headers from buffer
+    void setProgressLogging(bool enabled);
+    void setRateLimiter(std::shared_ptr<RateLimiter> limiter);
+    std::chrono::milliseconds getThrottleDelay() const; // after a read returned WantTime
+    std::string_view getBuffered() const; // bytes received but not yet consumed
+    void consume(size_t n);
+    void readResponse(HttpResponse &res);                                                                                        // reads the status line and headers into res
     std::string readContent(const size_t contentLength, const std::function<void(const std::string &data)> &callback = nullptr); // reads the body from the buffer
-    void readChunkedContent(const std::function<void(const std::string &)> &callback);                                           // reads the chunked data via buffer
+    void readChunkedContent(const BodyCallback &callback);                                                                       // decodes the chunked data in the buffer
     void readSpecifiedChunkedContent(const size_t contentLength,const std::function<void(const std::string&)>& callback);
+    size_t readContentInto(std::span<char> destination, const BodyCallback &onData = nullptr); // receives straight into destination
+    size_t spliceContent(int fileFd, size_t position, size_t contentLength); // socket to file in the kernel, buffered bytes excluded
+
+    // non-blocking reading for event loops, each call consumes what has arrived and
+    // returns Done once finished or what the socket has to become ready for
+    IoStatus tryReadResponse(HttpResponse &res);
+    void beginBody(BodyFraming framing, size_t contentLength = 0);
+    IoStatus tryReadBody(const BodyCallback &onData);
+    const HeaderMap &getTrailers() const; // trailer fields of the last chunked body
+
 private:
-    size_t getChunkSize();
-    void ensureCRLF();
-};
\ No newline at end of file
+    void takeResponse(HttpResponse &res);
+    size_t fillBuffer();
+    size_t receive(std::span<char> destination);
+    size_t waitForAllowance(size_t space);
+    IoStatus tryFillBuffer(size_t &received);
+    bool consumeBody(const BodyCallback &onData);
+};
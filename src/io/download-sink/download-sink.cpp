@@ -0,0 +1,204 @@
+#include "download-sink.hpp"
+
+// open the file for writing from the given offset, the file is created when missing.
+// it is opened for reading as well since a shared writable mapping needs that
+DownloadSink::DownloadSink(const std::string &p, size_t startOffset)
+    : path(p), fd(-1), offset(startOffset), directIo(false), stage(nullptr, &std::free), staged(0)
+{
+    fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+        throw std::runtime_error("failed to create/open the file " + path + ": " + std::strerror(errno));
+}
+
+DownloadSink::~DownloadSink()
+{
+    try
+    {
+        this->close();
+    }
+    catch (const std::exception &e)
+    {
+        std::clog << "[ERROR] " << e.what() << std::endl;
+    }
+}
+
+// reserve the blocks upto totalSize without changing the file size, so the
+// size of a partial file still tells how much has been downloaded
+bool DownloadSink::preallocate(size_t totalSize)
+{
+    if (totalSize <= offset)
+        return true;
+
+    if (fallocate(fd, FALLOC_FL_KEEP_SIZE, offset, totalSize - offset) == 0)
+        return true;
+
+    // some filesystems have no fallocate, the writes then allocate as they go
+    if (errno == EOPNOTSUPP || errno == ENOSYS)
+        return false;
+    throw std::runtime_error("failed to preallocate the file " + path + ": " + std::strerror(errno));
+}
+
+// stage the sequential writes in an aligned buffer and bypass the page cache
+bool DownloadSink::enableDirectIo()
+{
+    if (directIo)
+        return true;
+
+    void *buffer = nullptr;
+    if (posix_memalign(&buffer, DIRECT_IO_ALIGNMENT, DIRECT_IO_BUFFER_SIZE) != 0)
+        return false;
+    stage.reset(static_cast<char *>(buffer));
+
+    // check that the filesystem accepts O_DIRECT at all
+    if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_DIRECT) != 0)
+    {
+        stage.reset();
+        return false;
+    }
+    setDirectFlag(false);
+
+    directIo = true;
+    return true;
+}
+
+bool DownloadSink::isDirectIo() const
+{
+    return directIo;
+}
+
+// write at the current offset and move it forward
+void DownloadSink::write(const char *data, size_t size)
+{
+    if (!directIo)
+    {
+        writeFully(data, size, offset);
+        offset += size;
+        return;
+    }
+
+    while (size > 0)
+    {
+        // the start of the staging buffer has to be at an aligned offset,
+        // so bytes before the first aligned offset go through the page cache
+        size_t stageStart = offset - staged;
+        size_t toCopy = stageStart % DIRECT_IO_ALIGNMENT == 0
+                            ? std::min(size, (size_t)DIRECT_IO_BUFFER_SIZE - staged)
+                            : std::min(size, DIRECT_IO_ALIGNMENT - offset % DIRECT_IO_ALIGNMENT);
+
+        if (stageStart % DIRECT_IO_ALIGNMENT != 0)
+            writeFully(data, toCopy, offset);
+        else
+        {
+            std::memcpy(stage.get() + staged, data, toCopy);
+            staged += toCopy;
+        }
+
+        data += toCopy;
+        size -= toCopy;
+        offset += toCopy;
+
+        if (staged == DIRECT_IO_BUFFER_SIZE)
+            flushStage(false);
+    }
+}
+
+void DownloadSink::write(const std::string &data)
+{
+    write(data.data(), data.size());
+}
+
+// write at the given position, doesnt touch the sequential offset
+void DownloadSink::writeAt(size_t position, const char *data, size_t size)
+{
+    writeFully(data, size, position);
+}
+
+// offset after the last sequential write
+size_t DownloadSink::getOffset() const
+{
+    return offset;
+}
+
+int DownloadSink::getFd() const
+{
+    return fd;
+}
+
+// move the sequential offset over bytes someone else wrote at it
+void DownloadSink::advance(size_t size)
+{
+    offset += size;
+}
+
+// write out whatever is staged and close the file
+void DownloadSink::close()
+{
+    if (fd < 0)
+        return;
+
+    if (directIo)
+        flushStage(true);
+
+    ::close(fd);
+    fd = -1;
+}
+
+// pwrite till every byte is written
+void DownloadSink::writeFully(const char *data, size_t size, size_t position)
+{
+    size_t written = 0;
+
+    while (written < size)
+    {
+        ssize_t n = pwrite(fd, data + written, size - written, position + written);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error("failed to write the file " + path + ": " + std::strerror(errno));
+        }
+        written += n;
+    }
+
+    Metrics &metrics = Metrics::instance();
+    metrics.add(Counter::Writes);
+    metrics.add(Counter::BytesWritten, size);
+}
+
+// write the staged bytes with O_DIRECT, the unaligned tail is written through
+// the page cache when this is the final flush and kept otherwise
+void DownloadSink::flushStage(bool final)
+{
+    if (staged == 0)
+        return;
+
+    size_t stageStart = offset - staged;
+    size_t alignedSize = staged - staged % DIRECT_IO_ALIGNMENT;
+
+    if (alignedSize > 0)
+    {
+        setDirectFlag(true);
+        writeFully(stage.get(), alignedSize, stageStart);
+        setDirectFlag(false);
+    }
+
+    size_t tail = staged - alignedSize;
+    if (tail > 0 && final)
+    {
+        writeFully(stage.get() + alignedSize, tail, stageStart + alignedSize);
+        tail = 0;
+    }
+
+    std::memmove(stage.get(), stage.get() + alignedSize, tail);
+    staged = tail;
+}
+
+// toggle O_DIRECT on the file, only aligned writes are done while it is set
+void DownloadSink::setDirectFlag(bool enabled)
+{
+    int flags = fcntl(fd, F_GETFL);
+    flags = enabled ? (flags | O_DIRECT) : (flags & ~O_DIRECT);
+
+    if (fcntl(fd, F_SETFL, flags) != 0)
+        throw std::runtime_error("failed to toggle O_DIRECT on " + path + ": " + std::strerror(errno));
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "../../metrics/transfer-metrics/transfer-metrics.hpp"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define DIRECT_IO_ALIGNMENT 4096                  // O_DIRECT writes need block aligned buffers and offsets
+#define DIRECT_IO_BUFFER_SIZE (4 * 1024 * 1024)   // 4MB ke aligned writes
+#define DIRECT_IO_MIN_SIZE (64LL * 1024 * 1024)   // chote files page cache se hi likhe jayenge
+
+// an output file opened once per download, every write is positional
+class DownloadSink
+{
+    std::string path;
+    int fd;
+    size_t offset;    // where the next sequential write goes
+    bool directIo;    // sequential writes are staged and written with O_DIRECT
+    std::unique_ptr<char, decltype(&std::free)> stage; // aligned staging buffer for O_DIRECT
+    size_t staged;    // bytes waiting in the staging buffer
+
+public:
+    DownloadSink(const std::string &path, size_t startOffset = 0);
+    ~DownloadSink();
+    DownloadSink(const DownloadSink &) = delete;
+    DownloadSink &operator=(const DownloadSink &) = delete;
+
+    bool preallocate(size_t totalSize);       // reserves the blocks of the whole file upfront, false when the filesystem cant
+    bool enableDirectIo();                    // false when the filesystem doesnt support it
+    bool isDirectIo() const;
+    void write(const char *data, size_t size); // appends at the current offset
+    void write(const std::string &data);
+    void writeAt(size_t position, const char *data, size_t size); // safe to call from many threads
+    size_t getOffset() const;
+    int getFd() const;
+    void advance(size_t size); // account for bytes written to the fd directly
+    void close(); // flushes what is staged and closes the file
+
+private:
+    void writeFully(const char *data, size_t size, size_t position);
+    void flushStage(bool final);
+    void setDirectFlag(bool enabled);
+};
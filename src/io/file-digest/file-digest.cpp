@@ -0,0 +1,382 @@
+#include "file-digest.hpp"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define FILE_DIGEST_X86 1
+#endif
+
+#define CRC32C_POLYNOMIAL 0x82F63B78 // reflected Castagnoli polynomial
+
+static std::string lowercase(std::string_view value)
+{
+    std::string lower(value);
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c)
+                   { return std::tolower(c); });
+    return lower;
+}
+
+static std::string_view trim(std::string_view value)
+{
+    while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+        value.remove_prefix(1);
+    while (!value.empty() && (value.back() == ' ' || value.back() == '\t' || value.back() == '\r'))
+        value.remove_suffix(1);
+    return value;
+}
+
+static std::string toHex(const unsigned char *data, size_t size)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(size * 2);
+    for (size_t i = 0; i < size; i++)
+    {
+        hex += digits[data[i] >> 4];
+        hex += digits[data[i] & 0xf];
+    }
+    return hex;
+}
+
+static bool isHex(std::string_view value)
+{
+    return !value.empty() && std::all_of(value.begin(), value.end(), [](unsigned char c)
+                                         { return std::isxdigit(c); });
+}
+
+// header digests are base64, empty when the value isnt valid
+static std::string base64ToHex(std::string_view value)
+{
+    if (value.empty() || value.size() % 4 != 0)
+        return "";
+
+    std::vector<unsigned char> decoded(value.size() / 4 * 3);
+    int length = EVP_DecodeBlock(decoded.data(), reinterpret_cast<const unsigned char *>(value.data()), value.size());
+    if (length < 0)
+        return "";
+
+    // EVP_DecodeBlock counts the padding as zero bytes
+    size_t padding = value.ends_with("==") ? 2 : value.ends_with("=") ? 1 : 0;
+    return toHex(decoded.data(), length - padding);
+}
+
+DigestAlgorithm parseDigestAlgorithm(std::string_view name)
+{
+    std::string lower = lowercase(name);
+
+    if (lower == "sha256" || lower == "sha-256")
+        return DigestAlgorithm::Sha256;
+    if (lower == "sha1" || lower == "sha-1" || lower == "sha")
+        return DigestAlgorithm::Sha1;
+    if (lower == "md5")
+        return DigestAlgorithm::Md5;
+    if (lower == "crc32c")
+        return DigestAlgorithm::Crc32c;
+
+    throw std::runtime_error("unsupported checksum algorithm " + std::string(name));
+}
+
+const char *digestName(DigestAlgorithm algorithm)
+{
+    switch (algorithm)
+    {
+    case DigestAlgorithm::Sha256:
+        return "sha256";
+    case DigestAlgorithm::Sha1:
+        return "sha1";
+    case DigestAlgorithm::Md5:
+        return "md5";
+    case DigestAlgorithm::Crc32c:
+        return "crc32c";
+    }
+    return "unknown";
+}
+
+// hex digits in a digest of the algorithm
+static size_t hexLength(DigestAlgorithm algorithm)
+{
+    switch (algorithm)
+    {
+    case DigestAlgorithm::Sha256:
+        return 64;
+    case DigestAlgorithm::Sha1:
+        return 40;
+    case DigestAlgorithm::Md5:
+        return 32;
+    case DigestAlgorithm::Crc32c:
+        return 8;
+    }
+    return 0;
+}
+
+ExpectedDigest parseChecksumOption(const std::string &value)
+{
+    size_t colon = value.find(':');
+    ExpectedDigest expected{parseDigestAlgorithm(value.substr(0, colon)), "", "--checksum"};
+
+    if (colon != std::string::npos)
+    {
+        expected.hex = lowercase(value.substr(colon + 1));
+        if (!isHex(expected.hex) || expected.hex.size() != hexLength(expected.algorithm))
+            throw std::runtime_error("invalid " + std::string(digestName(expected.algorithm)) + " checksum " +
+                                     value.substr(colon + 1));
+    }
+    return expected;
+}
+
+std::optional<ExpectedDigest> digestFromHeaders(const HttpResponse &res)
+{
+    std::optional<ExpectedDigest> best;
+
+    // Repr-Digest: sha-256=:<base64>:, sha-512=:<base64>:
+    // Digest: SHA-256=<base64>, MD5=<base64>
+    for (HeaderName header : {Headers::ReprDigest, Headers::Digest})
+    {
+        std::string_view value = res.getHeader(header);
+
+        while (!value.empty())
+        {
+            size_t comma = value.find(',');
+            std::string_view member = trim(value.substr(0, comma));
+            value = comma == std::string_view::npos ? std::string_view() : value.substr(comma + 1);
+
+            size_t equals = member.find('=');
+            if (equals == std::string_view::npos)
+                continue;
+
+            std::string_view encoded = trim(member.substr(equals + 1));
+            if (encoded.size() >= 2 && encoded.front() == ':' && encoded.back() == ':')
+                encoded = encoded.substr(1, encoded.size() - 2);
+
+            // algorithms we cant compute like sha-512 are skipped
+            DigestAlgorithm algorithm;
+            try
+            {
+                algorithm = parseDigestAlgorithm(trim(member.substr(0, equals)));
+            }
+            catch (const std::exception &)
+            {
+                continue;
+            }
+
+            std::string hex = base64ToHex(encoded);
+            if (hex.size() != hexLength(algorithm))
+                continue;
+
+            // enum order goes from the strongest to the weakest
+            if (!best || algorithm < best->algorithm)
+                best = ExpectedDigest{algorithm, hex, std::string(header.name) + " header"};
+        }
+
+        if (best)
+            break;
+    }
+
+    return best;
+}
+
+std::optional<ExpectedDigest> digestFromChecksumFile(const std::string &text, const std::string &filename)
+{
+    std::istringstream lines(text);
+    std::string line;
+    std::optional<ExpectedDigest> lone;
+    size_t hashes = 0;
+
+    while (std::getline(lines, line))
+    {
+        std::string_view entry = trim(line);
+        if (entry.empty() || entry.front() == '#')
+            continue;
+
+        size_t space = entry.find_first_of(" \t");
+        std::string hex = lowercase(entry.substr(0, space));
+        std::string_view name = space == std::string_view::npos ? "" : trim(entry.substr(space));
+
+        // sha256sum -b marks binary files with a *
+        if (name.starts_with("*"))
+            name.remove_prefix(1);
+
+        std::optional<DigestAlgorithm> algorithm;
+        for (DigestAlgorithm candidate : {DigestAlgorithm::Sha256, DigestAlgorithm::Sha1, DigestAlgorithm::Md5, DigestAlgorithm::Crc32c})
+            if (hex.size() == hexLength(candidate))
+                algorithm = candidate;
+
+        if (!algorithm || !isHex(hex))
+            continue;
+
+        hashes++;
+        ExpectedDigest expected{*algorithm, hex, "checksum file"};
+
+        // the name may carry the directories of whoever made the list
+        if (!name.empty() && (name == filename || name.ends_with("/" + filename)))
+            return expected;
+
+        // a hash naming another file never applies to ours
+        if (name.empty())
+            lone = expected;
+    }
+
+    // a bare hash counts only when it is all the file has
+    if (hashes == 1)
+        return lone;
+    return std::nullopt;
+}
+
+FileDigest::FileDigest(DigestAlgorithm algorithm)
+    : algorithm(algorithm), ctx(nullptr), crc(0)
+{
+    if (algorithm == DigestAlgorithm::Crc32c)
+        return;
+
+    const EVP_MD *md = algorithm == DigestAlgorithm::Sha256 ? EVP_sha256()
+                       : algorithm == DigestAlgorithm::Sha1 ? EVP_sha1()
+                                                            : EVP_md5();
+
+    ctx = EVP_MD_CTX_new();
+    if (!ctx || EVP_DigestInit_ex(ctx, md, nullptr) != 1)
+    {
+        EVP_MD_CTX_free(ctx);
+        throw std::runtime_error("failed to set up " + std::string(digestName(algorithm)));
+    }
+}
+
+FileDigest::~FileDigest()
+{
+    EVP_MD_CTX_free(ctx);
+}
+
+void FileDigest::update(std::string_view data)
+{
+    if (ctx)
+        EVP_DigestUpdate(ctx, data.data(), data.size());
+    else
+        crc = crc32c(crc, data.data(), data.size());
+}
+
+void FileDigest::updateFromFile(const std::string &path, size_t length)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        throw std::runtime_error("cannot read " + path + " for the checksum");
+
+    std::unique_ptr<char[]> block(new char[FILE_DIGEST_READ_SIZE]);
+    while (length > 0)
+    {
+        file.read(block.get(), std::min<size_t>(length, FILE_DIGEST_READ_SIZE));
+        size_t n = file.gcount();
+        if (n == 0)
+            throw std::runtime_error(path + " is shorter than expected for the checksum");
+
+        update(std::string_view(block.get(), n));
+        length -= n;
+    }
+}
+
+std::string FileDigest::finish()
+{
+    if (!ctx)
+    {
+        // crc32c is written big endian like the checksums tools print
+        unsigned char bytes[4] = {static_cast<unsigned char>(crc >> 24), static_cast<unsigned char>(crc >> 16),
+                                  static_cast<unsigned char>(crc >> 8), static_cast<unsigned char>(crc)};
+        return toHex(bytes, sizeof(bytes));
+    }
+
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int length = 0;
+    EVP_DigestFinal_ex(ctx, digest, &length);
+    return toHex(digest, length);
+}
+
+DigestAlgorithm FileDigest::getAlgorithm() const
+{
+    return algorithm;
+}
+
+void verifyDigest(const ExpectedDigest &expected, const std::string &actual)
+{
+    if (!expected.hex.empty() && expected.hex != actual)
+        throw std::runtime_error(std::string(digestName(expected.algorithm)) + " mismatch, expected " + expected.hex +
+                                 " from the " + expected.source + " but the file has " + actual);
+}
+
+// one byte at a time through a 256 entry table
+static uint32_t crc32cTable(uint32_t crc, const char *data, size_t size)
+{
+    static const auto table = []()
+    {
+        std::array<uint32_t, 256> entries{};
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t value = i;
+            for (int bit = 0; bit < 8; bit++)
+                value = (value >> 1) ^ (value & 1 ? CRC32C_POLYNOMIAL : 0);
+            entries[i] = value;
+        }
+        return entries;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++)
+        crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+#ifdef FILE_DIGEST_X86
+
+// 8 bytes per instruction, only called when the cpu reports SSE4.2
+__attribute__((target("sse4.2"))) static uint32_t crc32cSse42(uint32_t crc, const char *data, size_t size)
+{
+    uint64_t value = ~crc;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        value = _mm_crc32_u64(value, word);
+    }
+
+    uint32_t tail = static_cast<uint32_t>(value);
+    for (; i < size; i++)
+        tail = _mm_crc32_u8(tail, static_cast<unsigned char>(data[i]));
+    return ~tail;
+}
+
+#endif
+
+struct Crc32cImplementation
+{
+    uint32_t (*update)(uint32_t, const char *, size_t);
+    const char *name;
+};
+
+static const Crc32cImplementation &crc32cSelected()
+{
+    static const Crc32cImplementation selected = []() -> Crc32cImplementation
+    {
+#ifdef FILE_DIGEST_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("sse4.2"))
+            return {crc32cSse42, "sse4.2"};
+#endif
+        return {crc32cTable, "table"};
+    }();
+    return selected;
+}
+
+uint32_t crc32c(uint32_t crc, const char *data, size_t size)
+{
+    return crc32cSelected().update(crc, data, size);
+}
+
+const char *crc32cImplementation()
+{
+    return crc32cSelected().name;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "../../http/http-response/http-response.hpp"
+#include <openssl/evp.h>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#define FILE_DIGEST_READ_SIZE (1024 * 1024) // 1MB reads when a file on disk has to be hashed
+
+// checksums a download can be verified with
+enum class DigestAlgorithm
+{
+    Sha256,
+    Sha1,
+    Md5,
+    Crc32c,
+};
+
+// sha256, sha-256, sha1, sha, md5 or crc32c in any case, throws for others
+DigestAlgorithm parseDigestAlgorithm(std::string_view name);
+const char *digestName(DigestAlgorithm algorithm);
+
+// a checksum the downloaded file has to match, hex is empty when the digest is only printed
+struct ExpectedDigest
+{
+    DigestAlgorithm algorithm;
+    std::string hex;
+    std::string source; // where the value came from, shown when it doesnt match
+};
+
+// <algorithm>[:<hex>] as given on the command line
+ExpectedDigest parseChecksumOption(const std::string &value);
+
+// the strongest digest of the whole representation in Repr-Digest or Digest, the
+// values are of the encoded body so a decompressed file cant be checked with them
+std::optional<ExpectedDigest> digestFromHeaders(const HttpResponse &res);
+
+// the line for filename in sha256sum style text ("<hex>  <name>"), a lone hash
+// without a name is taken for any file. the algorithm follows from the length of the hash
+std::optional<ExpectedDigest> digestFromChecksumFile(const std::string &text, const std::string &filename);
+
+// the checksum of a file built up while its bytes are written. SHA and MD5
+// come from OpenSSL's EVP which uses SHA-NI and AVX2 when the cpu has them,
+// CRC32C uses the SSE4.2 crc32 instruction and a table everywhere else.
+class FileDigest
+{
+    DigestAlgorithm algorithm;
+    EVP_MD_CTX *ctx; // nullptr for crc32c
+    uint32_t crc;
+
+public:
+    explicit FileDigest(DigestAlgorithm algorithm);
+    ~FileDigest();
+    FileDigest(const FileDigest &) = delete;
+    FileDigest &operator=(const FileDigest &) = delete;
+
+    void update(std::string_view data);
+    void updateFromFile(const std::string &path, size_t length); // bytes written before, like a resumed part
+    std::string finish();                                         // lowercase hex
+    DigestAlgorithm getAlgorithm() const;
+};
+
+// fails with both values when the file doesnt match
+void verifyDigest(const ExpectedDigest &expected, const std::string &actual);
+
+// crc32c (Castagnoli) continued from crc, the instruction is used when the cpu has it
+uint32_t crc32c(uint32_t crc, const char *data, size_t size);
+
+// name of the crc32c implementation in use: sse4.2 or table
+const char *crc32cImplementation();
@@ -0,0 +1,161 @@
+#include "io-uring.hpp"
+
+// create the ring and map its queues
+IoUring::IoUring(unsigned n)
+    : ringFd(-1), entries(0), sqRing(MAP_FAILED), sqRingSize(0), cqRing(MAP_FAILED), cqRingSize(0),
+      sqes(static_cast<struct io_uring_sqe *>(MAP_FAILED)), sqesSize(0), toSubmit(0)
+{
+    struct io_uring_params params{};
+    ringFd = syscall(__NR_io_uring_setup, n, &params);
+    if (ringFd < 0)
+        throw std::runtime_error(std::string("io_uring_setup failed: ") + std::strerror(errno));
+
+    entries = params.sq_entries;
+    sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+    // newer kernels map both rings with a single mmap
+    bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (singleMmap)
+        sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+
+    sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    if (sqRing == MAP_FAILED)
+    {
+        close(ringFd);
+        throw std::runtime_error("failed to map the io_uring submission queue");
+    }
+
+    cqRing = singleMmap ? sqRing
+                        : mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+    sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    // stored right away so release unmaps it when only the other mapping failed
+    sqes = static_cast<struct io_uring_sqe *>(
+        mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES));
+
+    if (cqRing == MAP_FAILED || sqes == MAP_FAILED)
+    {
+        release();
+        throw std::runtime_error("failed to map the io_uring queues");
+    }
+
+    char *sq = static_cast<char *>(sqRing);
+    sqHead = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+    sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sqMask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+
+    char *cq = static_cast<char *>(cqRing);
+    cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cqMask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<struct io_uring_cqe *>(cq + params.cq_off.cqes);
+}
+
+IoUring::~IoUring()
+{
+    release();
+}
+
+// unmap whatever got mapped and close the ring
+void IoUring::release()
+{
+    if (sqes != MAP_FAILED)
+        munmap(sqes, sqesSize);
+    if (cqRing != MAP_FAILED && cqRing != sqRing)
+        munmap(cqRing, cqRingSize);
+    if (sqRing != MAP_FAILED)
+        munmap(sqRing, sqRingSize);
+    if (ringFd >= 0)
+        close(ringFd);
+
+    sqes = static_cast<struct io_uring_sqe *>(MAP_FAILED);
+    cqRing = sqRing = MAP_FAILED;
+    ringFd = -1;
+}
+
+// try creating a tiny ring once, seccomp or old kernels refuse it
+bool IoUring::isSupported()
+{
+    static const bool supported = []()
+    {
+        struct io_uring_params params{};
+        int fd = syscall(__NR_io_uring_setup, 2, &params);
+        if (fd < 0)
+            return false;
+
+        close(fd);
+        return true;
+    }();
+
+    return supported;
+}
+
+// take the next free submission entry, zeroed
+struct io_uring_sqe *IoUring::getSqe()
+{
+    unsigned head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+    unsigned tail = *sqTail;
+
+    if (tail - head >= entries)
+        return nullptr;
+
+    unsigned index = tail & *sqMask;
+    struct io_uring_sqe *sqe = &sqes[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+
+    sqArray[index] = index;
+    __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+    toSubmit++;
+
+    return sqe;
+}
+
+// hand the prepared entries to the kernel, optionally waiting for completions
+void IoUring::submit(unsigned waitFor)
+{
+    while (true)
+    {
+        int submitted = syscall(__NR_io_uring_enter, ringFd, toSubmit, waitFor,
+                                waitFor > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+        if (submitted >= 0)
+        {
+            toSubmit -= std::min<unsigned>(toSubmit, submitted);
+            return;
+        }
+
+        if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+            throw std::runtime_error(std::string("io_uring_enter failed: ") + std::strerror(errno));
+    }
+}
+
+// look at the oldest completion without releasing it
+struct io_uring_cqe *IoUring::peekCqe()
+{
+    unsigned head = *cqHead;
+    unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+
+    if (head == tail)
+        return nullptr;
+
+    return &cqes[head & *cqMask];
+}
+
+void IoUring::seenCqe()
+{
+    __atomic_store_n(cqHead, *cqHead + 1, __ATOMIC_RELEASE);
+}
+
+// pin the buffers so the kernel doesnt map them on every operation
+void IoUring::registerBuffers(const struct iovec *iovecs, unsigned count)
+{
+    if (syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_BUFFERS, iovecs, count) < 0)
+        throw std::runtime_error(std::string("failed to register io_uring buffers: ") + std::strerror(errno));
+}
+
+// register the fds so the kernel doesnt look them up on every operation
+void IoUring::registerFiles(const int *fds, unsigned count)
+{
+    if (syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_FILES, fds, count) < 0)
+        throw std::runtime_error(std::string("failed to register io_uring files: ") + std::strerror(errno));
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// thin wrapper over the io_uring syscalls, owns the ring fd and the mapped
+// submission/completion queues. not thread safe, one thread drives a ring.
+class IoUring
+{
+    int ringFd;
+    unsigned entries;
+
+    void *sqRing;
+    size_t sqRingSize;
+    void *cqRing;
+    size_t cqRingSize;
+    struct io_uring_sqe *sqes;
+    size_t sqesSize;
+
+    unsigned *sqHead, *sqTail, *sqMask, *sqArray;
+    unsigned *cqHead, *cqTail, *cqMask;
+    struct io_uring_cqe *cqes;
+    unsigned toSubmit; // sqes prepared but not yet submitted
+
+public:
+    explicit IoUring(unsigned entries);
+    ~IoUring();
+    IoUring(const IoUring &) = delete;
+    IoUring &operator=(const IoUring &) = delete;
+
+    static bool isSupported(); // whether the kernel lets us create a ring at all
+
+    struct io_uring_sqe *getSqe(); // nullptr when the submission queue is full
+    void submit(unsigned waitFor); // submits the prepared sqes and waits for `waitFor` completions
+    struct io_uring_cqe *peekCqe(); // nullptr when no completion is pending
+    void seenCqe();                 // release the completion returned by peekCqe
+
+    void registerBuffers(const struct iovec *iovecs, unsigned count);
+    void registerFiles(const int *fds, unsigned count);
+
+private:
+    void release();
+};
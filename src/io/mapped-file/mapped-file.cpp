@@ -0,0 +1,117 @@
+#include "mapped-file.hpp"
+
+// grow the file to totalSize and map all of it, writes continue at startOffset
+MappedFile::MappedFile(int fd, size_t startOffset, size_t totalSize)
+    : fd(fd), map(nullptr), size(totalSize), offset(startOffset), pageSize(sysconf(_SC_PAGESIZE)), flusher(),
+      mutex(), wakeUp(), flushTarget(startOffset), flushed(startOffset - startOffset % pageSize), stopping(false)
+{
+    if (totalSize <= startOffset)
+        throw std::runtime_error("nothing left to map after offset " + std::to_string(startOffset));
+
+    // callers map only a file whose blocks the sink's preallocate reserved, so
+    // the pages cant hit a full disk later and fault with SIGBUS
+    if (ftruncate(fd, totalSize) != 0)
+        throw std::runtime_error(std::string("failed to grow the file for mapping: ") + std::strerror(errno));
+
+    void *address = mmap(nullptr, totalSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED)
+    {
+        int error = errno;
+        if (ftruncate(fd, startOffset) != 0)
+            error = errno;
+        throw std::runtime_error(std::string("failed to map the file: ") + std::strerror(error));
+    }
+    map = static_cast<char *>(address);
+
+    // the bytes are written once front to back and not read again
+    madvise(map, totalSize, MADV_SEQUENTIAL);
+
+    flusher = std::thread(&MappedFile::flushLoop, this);
+}
+
+MappedFile::~MappedFile()
+{
+    try
+    {
+        this->close();
+    }
+    catch (const std::exception &e)
+    {
+        std::clog << "[ERROR] " << e.what() << std::endl;
+    }
+}
+
+std::span<char> MappedFile::remaining()
+{
+    return std::span<char>(map + offset, size - offset);
+}
+
+void MappedFile::commit(size_t count)
+{
+    offset += count;
+    Metrics::instance().add(Counter::BytesWritten, count);
+
+    // the flusher only has to wake up once a whole window is ready
+    std::lock_guard<std::mutex> lock(mutex);
+    if (offset - flushTarget >= MAPPED_FILE_FLUSH_WINDOW || offset == size)
+    {
+        flushTarget = offset;
+        wakeUp.notify_one();
+    }
+}
+
+size_t MappedFile::getOffset() const
+{
+    return offset;
+}
+
+void MappedFile::close()
+{
+    if (!map)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeUp.notify_one();
+    flusher.join();
+
+    munmap(map, size);
+    map = nullptr;
+
+    // a download that stopped early keeps only what arrived
+    if (offset < size && ftruncate(fd, offset) != 0)
+        throw std::runtime_error(std::string("failed to truncate the mapped file: ") + std::strerror(errno));
+}
+
+void MappedFile::flushLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true)
+    {
+        wakeUp.wait(lock, [this]
+                    { return stopping || flushTarget - flushed >= MAPPED_FILE_FLUSH_WINDOW; });
+        if (stopping)
+            return;
+
+        size_t target = flushTarget;
+        lock.unlock();
+        writeBack(flushed, target);
+        lock.lock();
+    }
+}
+
+// start writing the whole pages in [from, to) to disk and unmap them, the data
+// stays in the page cache till the kernel has written it
+void MappedFile::writeBack(size_t from, size_t to)
+{
+    size_t end = to - to % pageSize;
+    if (end <= from)
+        return;
+
+    sync_file_range(fd, from, end - from, SYNC_FILE_RANGE_WRITE);
+    madvise(map + from, end - from, MADV_DONTNEED);
+    flushed = end;
+}
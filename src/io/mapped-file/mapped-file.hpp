@@ -0,0 +1,55 @@
+#pragma once
+
+#include "../../metrics/transfer-metrics/transfer-metrics.hpp"
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define MAPPED_FILE_FLUSH_WINDOW (32 * 1024 * 1024) // itne naye bytes ke baad background writeback shuru hoga
+
+// an output file mapped into memory so the socket reads land in the page
+// cache directly. the file is grown to its full size up front, the bytes are
+// committed in order as they arrive and a background thread starts the
+// writeback of every finished window and drops its pages from the mapping,
+// so a multi GB download doesnt pile up dirty or resident memory. on close a
+// file that wasnt filled is cut back to the committed bytes, its size then
+// still tells how much was downloaded.
+class MappedFile
+{
+    int fd;           // owned by the caller, has to be opened for reading and writing
+    char *map;
+    size_t size;      // full size of the file and of the mapping
+    size_t offset;    // end of the committed bytes
+    size_t pageSize;
+
+    std::thread flusher;
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    size_t flushTarget; // committed bytes the flusher may write back, guarded by mutex
+    size_t flushed;     // bytes already handed to writeback, used by the flusher only
+    bool stopping;
+
+public:
+    MappedFile(int fd, size_t startOffset, size_t totalSize);
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    std::span<char> remaining(); // the part of the mapping after the committed bytes
+    void commit(size_t count);   // count bytes at the offset have been filled
+    size_t getOffset() const;
+    void close();                // waits for the flusher, unmaps and truncates a short file
+
+private:
+    void flushLoop();
+    void writeBack(size_t from, size_t to);
+};
@@ -0,0 +1,56 @@
+#include "splice-pipe.hpp"
+
+SplicePipe::SplicePipe(size_t size)
+    : readEnd(-1), writeEnd(-1), capacity(0)
+{
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) != 0)
+        throw std::runtime_error(std::string("failed to create the splice pipe: ") + std::strerror(errno));
+    readEnd = fds[0];
+    writeEnd = fds[1];
+
+    // a bigger pipe means fewer splices, unprivileged users are capped by /proc/sys/fs/pipe-max-size
+    int granted = fcntl(writeEnd, F_SETPIPE_SZ, (int)size);
+    if (granted < 0)
+        granted = fcntl(writeEnd, F_GETPIPE_SZ);
+    capacity = granted > 0 ? granted : 65536;
+}
+
+SplicePipe::~SplicePipe()
+{
+    close(readEnd);
+    close(writeEnd);
+}
+
+size_t SplicePipe::getCapacity() const
+{
+    return capacity;
+}
+
+size_t SplicePipe::transfer(int socketFd, int fileFd, size_t position, size_t length)
+{
+    ssize_t moved;
+    do
+        moved = splice(socketFd, nullptr, writeEnd, nullptr, std::min(length, capacity), SPLICE_F_MOVE | SPLICE_F_MORE);
+    while (moved < 0 && errno == EINTR);
+
+    if (moved < 0)
+        throw std::runtime_error(std::string("failed to splice from the socket: ") + std::strerror(errno));
+
+    // the pipe is emptied every time so the next call has the whole capacity
+    loff_t offset = position;
+    size_t pending = moved;
+    while (pending > 0)
+    {
+        ssize_t written = splice(readEnd, nullptr, fileFd, &offset, pending, SPLICE_F_MOVE);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error(std::string("failed to splice to the file: ") + std::strerror(errno));
+        }
+        pending -= written;
+    }
+
+    return moved;
+}
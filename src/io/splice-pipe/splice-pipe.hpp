@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cerrno>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define SPLICE_PIPE_SIZE (1024 * 1024) // 1MB ka pipe, ek splice me itna hi move hota hai
+
+// moves bytes from a socket to a file with splice() through a pipe, the
+// payload only changes hands between kernel pages and never reaches user
+// space. only works on fds carrying the bytes as they are, so plain TCP
+// or a kTLS receive socket where the kernel already decrypted the records.
+class SplicePipe
+{
+    int readEnd;
+    int writeEnd;
+    size_t capacity; // what the kernel granted, can be less than asked for
+
+public:
+    explicit SplicePipe(size_t size = SPLICE_PIPE_SIZE);
+    ~SplicePipe();
+    SplicePipe(const SplicePipe &) = delete;
+    SplicePipe &operator=(const SplicePipe &) = delete;
+
+    size_t getCapacity() const;
+
+    // moves up to length bytes that are available on the socket to the file at
+    // position, blocks till some arrive. 0 when the peer closed the connection
+    size_t transfer(int socketFd, int fileFd, size_t position, size_t length);
+};
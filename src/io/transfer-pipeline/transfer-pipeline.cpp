@@ -0,0 +1,171 @@
+#include "transfer-pipeline.hpp"
+
+// allocate the buffer pool upfront and start the writer thread
+TransferPipeline::TransferPipeline(DownloadSink &s, size_t queueDepth, size_t bufSize)
+    : sink(s), bufferSize(bufSize), freeBuffers(queueDepth + 1), filledBuffers(queueDepth),
+      current(nullptr), finished(false), networkStallNs(0), writerStallNs(0), buffersWritten(0), bytesWritten(0)
+{
+    // one more than the queue depth so the network stage can fill while the queue is full
+    for (size_t i = 0; i < queueDepth + 1; i++)
+    {
+        pool.push_back(std::make_unique<PipelineBuffer>(PipelineBuffer{std::make_unique<char[]>(bufferSize), 0, false, 0}));
+        freeBuffers.push(pool.back().get());
+    }
+
+    writer = std::thread(&TransferPipeline::writerLoop, this);
+}
+
+TransferPipeline::~TransferPipeline()
+{
+    try
+    {
+        finish();
+    }
+    catch (const std::exception &e)
+    {
+        std::clog << "[ERROR] " << e.what() << std::endl;
+    }
+}
+
+// copy the bytes into the current buffer, full buffers are handed to the writer
+void TransferPipeline::write(const char *data, size_t size)
+{
+    while (size > 0)
+    {
+        if (!current)
+            current = acquire();
+
+        size_t toCopy = std::min(size, bufferSize - current->size);
+        std::memcpy(current->data.get() + current->size, data, toCopy);
+        current->size += toCopy;
+        data += toCopy;
+        size -= toCopy;
+
+        if (current->size == bufferSize)
+        {
+            submit(current);
+            current = nullptr;
+        }
+    }
+}
+
+// copy the bytes into buffers of their own tagged with the file position
+void TransferPipeline::writeAt(size_t position, const char *data, size_t size)
+{
+    while (size > 0)
+    {
+        PipelineBuffer *buffer = acquire();
+
+        size_t toCopy = std::min(size, bufferSize);
+        std::memcpy(buffer->data.get(), data, toCopy);
+        buffer->size = toCopy;
+        buffer->positional = true;
+        buffer->position = position;
+
+        submit(buffer);
+        position += toCopy;
+        data += toCopy;
+        size -= toCopy;
+    }
+}
+
+// hand over the partly filled buffer and wait till the writer drained everything
+void TransferPipeline::finish()
+{
+    if (finished.exchange(true))
+        return;
+
+    if (current && current->size > 0)
+        submit(current);
+    current = nullptr;
+
+    filledBuffers.close();
+    writer.join();
+
+    Metrics &metrics = Metrics::instance();
+    metrics.add(Counter::NetworkStallMicros, networkStallNs.load() / 1000);
+    metrics.add(Counter::WriterStallMicros, writerStallNs.load() / 1000);
+
+    if (writerError)
+        std::rethrow_exception(writerError);
+}
+
+PipelineStats TransferPipeline::getStats() const
+{
+    return PipelineStats{
+        std::chrono::nanoseconds(networkStallNs.load()),
+        std::chrono::nanoseconds(writerStallNs.load()),
+        buffersWritten.load(),
+        bytesWritten.load()};
+}
+
+// show how long each stage waited on the other one
+void TransferPipeline::logStats() const
+{
+    PipelineStats stats = getStats();
+    std::clog << "pipeline: " << stats.bytesWritten << " bytes in " << stats.buffersWritten << " buffers, "
+              << "network stalled " << std::chrono::duration_cast<std::chrono::milliseconds>(stats.networkStall).count() << "ms, "
+              << "writer stalled " << std::chrono::duration_cast<std::chrono::milliseconds>(stats.writerStall).count() << "ms"
+              << std::endl;
+}
+
+// take an empty buffer from the pool, waits while all of them are queued for writing
+PipelineBuffer *TransferPipeline::acquire()
+{
+    auto start = std::chrono::steady_clock::now();
+    std::optional<PipelineBuffer *> buffer = freeBuffers.pop();
+    networkStallNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+    // the writer closes the pool when it failed
+    if (!buffer)
+        throw std::runtime_error("pipeline writer stopped");
+
+    (*buffer)->size = 0;
+    (*buffer)->positional = false;
+    return *buffer;
+}
+
+// queue a filled buffer for the writer, waits while the queue is full
+void TransferPipeline::submit(PipelineBuffer *buffer)
+{
+    auto start = std::chrono::steady_clock::now();
+    bool queued = filledBuffers.push(buffer);
+    networkStallNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+    if (!queued)
+        throw std::runtime_error("pipeline writer stopped");
+}
+
+// drain the filled buffers into the sink and give them back to the pool
+void TransferPipeline::writerLoop()
+{
+    try
+    {
+        while (true)
+        {
+            auto start = std::chrono::steady_clock::now();
+            std::optional<PipelineBuffer *> buffer = filledBuffers.pop();
+            writerStallNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+            if (!buffer)
+                break;
+
+            PipelineBuffer *filled = *buffer;
+            if (filled->positional)
+                sink.writeAt(filled->position, filled->data.get(), filled->size);
+            else
+                sink.write(filled->data.get(), filled->size);
+
+            buffersWritten++;
+            bytesWritten += filled->size;
+            freeBuffers.push(filled);
+        }
+    }
+    catch (...)
+    {
+        // stop the producers instead of letting them wait for buffers forever
+        writerError = std::current_exception();
+        freeBuffers.close();
+        filledBuffers.close();
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "../../buffer/bounded-queue/bounded-queue.hpp"
+#include "../download-sink/download-sink.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define PIPELINE_BUFFER_SIZE (256 * 1024) // 256KB ke pooled buffers
+#define PIPELINE_QUEUE_DEPTH 8            // itne buffers disk pe likhne ke liye ruk sakte hain
+
+// a pooled buffer travelling from the network stage to the disk stage
+struct PipelineBuffer
+{
+    std::unique_ptr<char[]> data;
+    size_t size;       // no of bytes filled
+    bool positional;   // written at `position` instead of the sink's offset
+    size_t position;
+};
+
+// time each stage spent waiting on the other one
+struct PipelineStats
+{
+    std::chrono::nanoseconds networkStall; // network waited for a free buffer (disk was behind)
+    std::chrono::nanoseconds writerStall;  // writer waited for a filled buffer (network was behind)
+    size_t buffersWritten;
+    size_t bytesWritten;
+};
+
+// decouples receiving from writing, the network stage copies the received
+// bytes into pooled buffers and a writer thread drains them into the sink.
+// the bounded queue between them makes the network stage wait when the disk
+// falls more than `queueDepth` buffers behind.
+class TransferPipeline
+{
+    DownloadSink &sink;
+    size_t bufferSize;
+    std::vector<std::unique_ptr<PipelineBuffer>> pool;
+    BoundedQueue<PipelineBuffer *> freeBuffers;   // writer -> network
+    BoundedQueue<PipelineBuffer *> filledBuffers; // network -> writer
+    PipelineBuffer *current;                      // buffer being filled by sequential writes
+    std::thread writer;
+    std::exception_ptr writerError;
+    std::atomic<bool> finished;
+
+    std::atomic<long long> networkStallNs;
+    std::atomic<long long> writerStallNs;
+    std::atomic<size_t> buffersWritten;
+    std::atomic<size_t> bytesWritten;
+
+public:
+    TransferPipeline(DownloadSink &sink, size_t queueDepth = PIPELINE_QUEUE_DEPTH, size_t bufferSize = PIPELINE_BUFFER_SIZE);
+    ~TransferPipeline();
+    TransferPipeline(const TransferPipeline &) = delete;
+    TransferPipeline &operator=(const TransferPipeline &) = delete;
+
+    void write(const char *data, size_t size);                      // appends in order, from a single producer only
+    void writeAt(size_t position, const char *data, size_t size);  // positional, safe from many producers
+    void finish();                                                  // waits till everything is written, rethrows write errors
+    PipelineStats getStats() const;
+    void logStats() const;
+
+private:
+    PipelineBuffer *acquire();
+    void submit(PipelineBuffer *buffer);
+    void writerLoop();
+};
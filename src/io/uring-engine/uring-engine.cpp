@@ -0,0 +1,161 @@
+#include "uring-engine.hpp"
+
+// fixed file indexes of the registered fds
+#define SOCKET_FILE_INDEX 0
+#define OUTPUT_FILE_INDEX 1
+
+// user_data of an operation is the slot with the lowest bit set for writes
+#define WRITE_FLAG 1
+
+// register the buffers and both fds with a new ring
+UringEngine::UringEngine(int socketFd, int fileFd, size_t bufferCount, size_t bufSize)
+    : memory(std::make_unique<char[]>(bufferCount * bufSize)),
+      bufferSize(bufSize),
+      slots(bufferCount),
+      ring(std::max<unsigned>(URING_QUEUE_ENTRIES, bufferCount + 1))
+{
+    std::vector<struct iovec> iovecs(bufferCount);
+    for (size_t i = 0; i < bufferCount; i++)
+    {
+        iovecs[i].iov_base = bufferOf(i);
+        iovecs[i].iov_len = bufferSize;
+        freeSlots.push_back(bufferCount - 1 - i);
+    }
+    ring.registerBuffers(iovecs.data(), iovecs.size());
+
+    int fds[] = {socketFd, fileFd};
+    ring.registerFiles(fds, 2);
+}
+
+bool UringEngine::isAvailable()
+{
+    return IoUring::isSupported();
+}
+
+// keep one receive and any no of writes in flight till the body is on disk
+size_t UringEngine::transfer(size_t fileOffset, size_t length)
+{
+    size_t received = 0;
+    bool receiving = false;
+    bool peerClosed = false;
+    unsigned writesInFlight = 0;
+
+    while (true)
+    {
+        bool wantsMore = !peerClosed && (length == 0 || received < length);
+
+        if (!receiving && wantsMore && !freeSlots.empty())
+        {
+            unsigned slot = freeSlots.back();
+            freeSlots.pop_back();
+
+            size_t toReceive = length == 0 ? bufferSize : std::min(bufferSize, length - received);
+            queueReceive(slot, toReceive);
+            receiving = true;
+        }
+
+        if (!receiving && writesInFlight == 0)
+            break;
+
+        // submits the queued receive and writes together and waits for one of them
+        ring.submit(1);
+
+        struct io_uring_cqe *cqe;
+        while ((cqe = ring.peekCqe()) != nullptr)
+        {
+            unsigned slot = cqe->user_data >> 1;
+            bool isWrite = cqe->user_data & WRITE_FLAG;
+            int result = cqe->res;
+            ring.seenCqe();
+
+            if (result == -EINTR || result == -EAGAIN)
+            {
+                // try the same operation again
+                if (isWrite)
+                    queueWrite(slot);
+                else
+                {
+                    receiving = false;
+                    freeSlots.push_back(slot);
+                }
+                continue;
+            }
+
+            if (result < 0)
+                throw std::runtime_error(std::string(isWrite ? "io_uring write failed: " : "io_uring receive failed: ") +
+                                         std::strerror(-result));
+
+            if (!isWrite)
+            {
+                receiving = false;
+
+                if (result == 0)
+                {
+                    peerClosed = true;
+                    freeSlots.push_back(slot);
+                    continue;
+                }
+
+                slots[slot] = Slot{(size_t)result, 0, fileOffset + received};
+                received += result;
+
+                queueWrite(slot);
+                writesInFlight++;
+                continue;
+            }
+
+            // short writes continue from where they stopped
+            slots[slot].written += result;
+            if (slots[slot].written < slots[slot].length)
+            {
+                queueWrite(slot);
+                continue;
+            }
+
+            writesInFlight--;
+            freeSlots.push_back(slot);
+        }
+    }
+
+    return received;
+}
+
+char *UringEngine::bufferOf(unsigned slot)
+{
+    return memory.get() + slot * bufferSize;
+}
+
+// receive into the slot's registered buffer
+void UringEngine::queueReceive(unsigned slot, size_t length)
+{
+    struct io_uring_sqe *sqe = ring.getSqe();
+    if (!sqe)
+        throw std::runtime_error("io_uring submission queue full");
+
+    sqe->opcode = IORING_OP_READ_FIXED;
+    sqe->flags = IOSQE_FIXED_FILE;
+    sqe->fd = SOCKET_FILE_INDEX;
+    sqe->addr = reinterpret_cast<unsigned long long>(bufferOf(slot));
+    sqe->len = length;
+    sqe->off = -1; // sockets have no position
+    sqe->buf_index = slot;
+    sqe->user_data = slot << 1;
+}
+
+// write the not yet written part of the slot's buffer at its file offset
+void UringEngine::queueWrite(unsigned slot)
+{
+    struct io_uring_sqe *sqe = ring.getSqe();
+    if (!sqe)
+        throw std::runtime_error("io_uring submission queue full");
+
+    const Slot &s = slots[slot];
+    sqe->opcode = IORING_OP_WRITE_FIXED;
+    sqe->flags = IOSQE_FIXED_FILE;
+    sqe->fd = OUTPUT_FILE_INDEX;
+    sqe->addr = reinterpret_cast<unsigned long long>(bufferOf(slot) + s.written);
+    sqe->len = s.length - s.written;
+    sqe->off = s.position + s.written;
+    sqe->buf_index = slot;
+    sqe->user_data = (slot << 1) | WRITE_FLAG;
+}
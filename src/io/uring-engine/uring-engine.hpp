@@ -0,0 +1,41 @@
+#pragma once
+
+#include "../io-uring/io-uring.hpp"
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#define URING_BUFFER_SIZE (256 * 1024) // 256KB ke registered buffers
+#define URING_QUEUE_ENTRIES 64
+
+// moves a body from a socket to a file with io_uring. one receive is kept in
+// flight on the socket so the bytes stay in order, every completed receive
+// queues a write of that buffer at its file offset and the next receive in
+// the same io_uring_enter, so the thread never blocks in recv or write.
+class UringEngine
+{
+    struct Slot
+    {
+        size_t length;   // bytes received into the buffer
+        size_t written;  // bytes of it already written
+        size_t position; // file offset of the first byte
+    };
+
+    std::unique_ptr<char[]> memory; // backing memory of all the registered buffers
+    size_t bufferSize;
+    std::vector<Slot> slots;
+    std::vector<unsigned> freeSlots;
+    IoUring ring; // destroyed before the memory it has registered
+
+public:
+    UringEngine(int socketFd, int fileFd, size_t bufferCount, size_t bufferSize = URING_BUFFER_SIZE);
+
+    static bool isAvailable();
+    size_t transfer(size_t fileOffset, size_t length); // length 0 reads till the peer closes, returns bytes written
+
+private:
+    char *bufferOf(unsigned slot);
+    void queueReceive(unsigned slot, size_t length);
+    void queueWrite(unsigned slot);
+};
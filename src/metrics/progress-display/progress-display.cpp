@@ -0,0 +1,54 @@
+#include "progress-display.hpp"
+
+ProgressDisplay::ProgressDisplay(std::function<size_t()> progress, size_t total)
+    : progress(std::move(progress)), total(total), startedAt(std::chrono::steady_clock::now()), drawer(), mutex(),
+      wakeUp(), stopping(false)
+{
+    drawer = std::thread(&ProgressDisplay::drawLoop, this);
+}
+
+ProgressDisplay::~ProgressDisplay()
+{
+    stop();
+}
+
+void ProgressDisplay::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping)
+            return;
+        stopping = true;
+    }
+
+    wakeUp.notify_one();
+    drawer.join();
+
+    draw();
+    std::clog << std::endl;
+}
+
+void ProgressDisplay::drawLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (!wakeUp.wait_for(lock, std::chrono::milliseconds(PROGRESS_REDRAW_MS), [this]
+                            { return stopping; }))
+        draw();
+}
+
+// "downloading 42.5% (2.1 of 5.0 MB, 11.3 MB/s)"
+void ProgressDisplay::draw()
+{
+    size_t done = progress();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startedAt).count();
+    double mb = done / (1024.0 * 1024.0);
+    double speed = seconds > 0 ? mb / seconds : 0;
+
+    std::clog << std::fixed << std::setprecision(1) << "\rdownloading ";
+    if (total > 0)
+        std::clog << done * 100.0 / total << "% (" << mb << " of " << total / (1024.0 * 1024.0) << " MB, ";
+    else
+        std::clog << mb << " MB (";
+    std::clog << speed << " MB/s)   " << std::defaultfloat << std::flush;
+}
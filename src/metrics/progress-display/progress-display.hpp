@@ -0,0 +1,37 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#define PROGRESS_REDRAW_MS 250 // status line itni der me ek baar redraw hogi
+
+// redraws the download status line from its own thread at a fixed rate, so
+// the receive loops only bump counters and never write to the terminal
+class ProgressDisplay
+{
+    std::function<size_t()> progress; // bytes done so far, called from the display thread
+    size_t total;                     // 0 when unknown
+    std::chrono::steady_clock::time_point startedAt;
+    std::thread drawer;
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    bool stopping;
+
+public:
+    ProgressDisplay(std::function<size_t()> progress, size_t total);
+    ~ProgressDisplay();
+    ProgressDisplay(const ProgressDisplay &) = delete;
+    ProgressDisplay &operator=(const ProgressDisplay &) = delete;
+
+    void stop(); // draws the final state and ends the line
+
+private:
+    void drawLoop();
+    void draw();
+};
@@ -0,0 +1,309 @@
+#include "transfer-metrics.hpp"
+
+// names in the dumps, in the order of the enums
+static const char *PHASE_NAMES[METRICS_PHASES] = {"dns", "connect", "tls_handshake", "first_byte", "body"};
+
+static const char *COUNTER_NAMES[METRICS_COUNTERS] = {
+    "bytes_received", "reads", "read_waits", "read_throttled", "bytes_written", "writes",
+    "network_stall_micros", "writer_stall_micros", "connections_opened", "connections_reused",
+    "tls_full_handshakes", "tls_resumed_handshakes", "tls_kernel_receive_connections",
+    "tls_user_receive_connections", "completed", "failed"};
+
+// 0.5ms se 30s tak
+static const std::vector<double> LATENCY_BOUNDS = {0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1,
+                                                   0.25, 0.5, 1, 2.5, 5, 10, 30};
+
+// 64KB/s to 4GB/s in steps of four
+static const std::vector<double> THROUGHPUT_BOUNDS = {65536, 262144, 1048576, 4194304, 16777216, 67108864,
+                                                      268435456, 1073741824, 4294967296};
+
+Histogram::Histogram(std::vector<double> b)
+    : bounds(std::move(b)), counts(new std::atomic<uint64_t>[bounds.size() + 1]), count(0), sum(0)
+{
+    for (size_t i = 0; i <= bounds.size(); i++)
+        counts[i] = 0;
+}
+
+void Histogram::observe(double value)
+{
+    size_t i = 0;
+    while (i < bounds.size() && value > bounds[i])
+        i++;
+
+    counts[i].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(value, std::memory_order_relaxed);
+}
+
+const std::vector<double> &Histogram::getBounds() const
+{
+    return bounds;
+}
+
+uint64_t Histogram::getBucket(size_t i) const
+{
+    return counts[i].load(std::memory_order_relaxed);
+}
+
+uint64_t Histogram::getCount() const
+{
+    return count.load(std::memory_order_relaxed);
+}
+
+double Histogram::getSum() const
+{
+    return sum.load(std::memory_order_relaxed);
+}
+
+Metrics::Metrics()
+    : startedAt(std::chrono::steady_clock::now()), counters(), phases(), throughput(THROUGHPUT_BOUNDS), transfers(),
+      mutex()
+{
+    for (std::atomic<uint64_t> &counter : counters)
+        counter = 0;
+    for (int i = 0; i < METRICS_PHASES; i++)
+        phases.push_back(std::make_unique<Histogram>(LATENCY_BOUNDS));
+}
+
+Metrics &Metrics::instance()
+{
+    static Metrics metrics;
+    return metrics;
+}
+
+void Metrics::add(Counter counter, uint64_t n)
+{
+    counters[(size_t)counter].fetch_add(n, std::memory_order_relaxed);
+}
+
+uint64_t Metrics::get(Counter counter) const
+{
+    return counters[(size_t)counter].load(std::memory_order_relaxed);
+}
+
+void Metrics::observe(Phase phase, std::chrono::steady_clock::duration elapsed)
+{
+    phases[(size_t)phase]->observe(std::chrono::duration<double>(elapsed).count());
+}
+
+void Metrics::observeThroughput(size_t bytes, std::chrono::steady_clock::duration elapsed)
+{
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    if (seconds > 0)
+        throughput.observe(bytes / seconds);
+}
+
+void Metrics::record(const TransferRecord &transfer)
+{
+    add(transfer.failed ? Counter::DownloadsFailed : Counter::DownloadsCompleted);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (transfers.size() < METRICS_MAX_TRANSFERS)
+        transfers.push_back(transfer);
+}
+
+double Metrics::msSinceStart(std::chrono::steady_clock::time_point at) const
+{
+    if (at == std::chrono::steady_clock::time_point())
+        return -1;
+    return std::chrono::duration<double, std::milli>(at - startedAt).count();
+}
+
+// quote a string for JSON
+static std::string quoted(const std::string &value)
+{
+    std::string out = "\"";
+    for (char c : value)
+    {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        if ((unsigned char)c < 0x20)
+        {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+            continue;
+        }
+        out += c;
+    }
+    return out + "\"";
+}
+
+static void histogramJson(std::ostringstream &out, const Histogram &histogram)
+{
+    out << "{\"count\": " << histogram.getCount() << ", \"sum\": " << histogram.getSum() << ", \"buckets\": [";
+
+    const std::vector<double> &bounds = histogram.getBounds();
+    for (size_t i = 0; i <= bounds.size(); i++)
+    {
+        out << (i ? ", " : "") << "{\"le\": ";
+        if (i < bounds.size())
+            out << bounds[i];
+        else
+            out << "\"+Inf\"";
+        out << ", \"count\": " << histogram.getBucket(i) << "}";
+    }
+    out << "]}";
+}
+
+std::string Metrics::toJson() const
+{
+    std::ostringstream out;
+    out.precision(12);
+    out << "{\n  \"uptime_seconds\": " << msSinceStart(std::chrono::steady_clock::now()) / 1000 << ",\n";
+
+    out << "  \"counters\": {";
+    for (size_t i = 0; i < METRICS_COUNTERS; i++)
+        out << (i ? ", " : "") << quoted(COUNTER_NAMES[i]) << ": " << counters[i].load();
+    out << "},\n";
+
+    out << "  \"latency_seconds\": {\n";
+    for (size_t i = 0; i < METRICS_PHASES; i++)
+    {
+        out << "    " << quoted(PHASE_NAMES[i]) << ": ";
+        histogramJson(out, *phases[i]);
+        out << (i + 1 < METRICS_PHASES ? ",\n" : "\n");
+    }
+    out << "  },\n";
+
+    out << "  \"throughput_bytes_per_second\": ";
+    histogramJson(out, throughput);
+    out << ",\n";
+
+    std::lock_guard<std::mutex> lock(mutex);
+    out << "  \"transfers\": [";
+    for (size_t i = 0; i < transfers.size(); i++)
+    {
+        const TransferRecord &t = transfers[i];
+        out << (i ? ",\n" : "\n") << "    {\"url\": " << quoted(t.url) << ", \"start_ms\": " << t.startMs
+            << ", \"connected_ms\": " << t.connectedMs << ", \"request_sent_ms\": " << t.requestSentMs
+            << ", \"first_byte_ms\": " << t.firstByteMs << ", \"finished_ms\": " << t.finishedMs
+            << ", \"bytes\": " << t.bytes << ", \"failed\": " << (t.failed ? "true" : "false") << "}";
+    }
+    out << (transfers.empty() ? "]\n" : "\n  ]\n") << "}\n";
+
+    return out.str();
+}
+
+static void histogramPrometheus(std::ostringstream &out, const std::string &name, const Histogram &histogram)
+{
+    const std::vector<double> &bounds = histogram.getBounds();
+    uint64_t cumulative = 0;
+
+    for (size_t i = 0; i <= bounds.size(); i++)
+    {
+        cumulative += histogram.getBucket(i);
+        out << name << "_bucket{le=\"";
+        if (i < bounds.size())
+            out << bounds[i];
+        else
+            out << "+Inf";
+        out << "\"} " << cumulative << "\n";
+    }
+    out << name << "_sum " << histogram.getSum() << "\n"
+        << name << "_count " << histogram.getCount() << "\n";
+}
+
+std::string Metrics::toPrometheus() const
+{
+    std::ostringstream out;
+    out.precision(12);
+
+    for (size_t i = 0; i < METRICS_COUNTERS; i++)
+    {
+        std::string name = std::string("download_") + COUNTER_NAMES[i] + "_total";
+        out << "# TYPE " << name << " counter\n"
+            << name << " " << counters[i].load() << "\n";
+    }
+
+    for (size_t i = 0; i < METRICS_PHASES; i++)
+    {
+        std::string name = std::string("download_") + PHASE_NAMES[i] + "_seconds";
+        out << "# TYPE " << name << " histogram\n";
+        histogramPrometheus(out, name, *phases[i]);
+    }
+
+    out << "# TYPE download_throughput_bytes_per_second histogram\n";
+    histogramPrometheus(out, "download_throughput_bytes_per_second", throughput);
+
+    return out.str();
+}
+
+void Metrics::writeTo(const std::string &path, MetricsFormat format) const
+{
+    std::string text = format == MetricsFormat::Json ? toJson() : toPrometheus();
+
+    if (path == "-")
+    {
+        std::cout << text << std::flush;
+        return;
+    }
+
+    std::ofstream file(path);
+    if (!file || !(file << text))
+        throw std::runtime_error("failed to write the metrics to " + path);
+}
+
+// the timer starts on construction, a retried download starts it again
+TransferTimer::TransferTimer(const std::string &url)
+    : url(url), startedAt(), connectedAt(), requestSentAt(), firstByteAt()
+{
+    // timestamps count from the creation of the metrics, which has to come first
+    Metrics::instance();
+    start();
+}
+
+void TransferTimer::start()
+{
+    startedAt = std::chrono::steady_clock::now();
+    connectedAt = requestSentAt = firstByteAt = std::chrono::steady_clock::time_point();
+}
+
+void TransferTimer::connected()
+{
+    connectedAt = std::chrono::steady_clock::now();
+}
+
+void TransferTimer::requestSent()
+{
+    requestSentAt = std::chrono::steady_clock::now();
+}
+
+void TransferTimer::firstByte()
+{
+    firstByteAt = std::chrono::steady_clock::now();
+    if (requestSentAt != std::chrono::steady_clock::time_point())
+        Metrics::instance().observe(Phase::FirstByte, firstByteAt - requestSentAt);
+}
+
+void TransferTimer::finished(size_t bytes, bool failed)
+{
+    auto now = std::chrono::steady_clock::now();
+    Metrics &metrics = Metrics::instance();
+
+    if (!failed && firstByteAt != std::chrono::steady_clock::time_point())
+    {
+        metrics.observe(Phase::Body, now - firstByteAt);
+        metrics.observeThroughput(bytes, now - firstByteAt);
+    }
+
+    TransferRecord transfer;
+    transfer.url = url;
+    transfer.startMs = metrics.msSinceStart(startedAt);
+    transfer.connectedMs = metrics.msSinceStart(connectedAt);
+    transfer.requestSentMs = metrics.msSinceStart(requestSentAt);
+    transfer.firstByteMs = metrics.msSinceStart(firstByteAt);
+    transfer.finishedMs = metrics.msSinceStart(now);
+    transfer.bytes = bytes;
+    transfer.failed = failed;
+    metrics.record(transfer);
+}
+
+MetricsFormat parseMetricsFormat(const std::string &value)
+{
+    if (value == "json")
+        return MetricsFormat::Json;
+    if (value == "prometheus" || value == "prom")
+        return MetricsFormat::Prometheus;
+    throw std::runtime_error("unknown metrics format '" + value + "', use json or prometheus");
+}
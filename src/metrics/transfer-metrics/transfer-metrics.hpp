@@ -0,0 +1,136 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#define METRICS_MAX_TRANSFERS 10000 // transfers kept for the dump, a huge batch only keeps the first ones
+
+// steps every transfer goes through, each one has a latency histogram
+enum class Phase
+{
+    Dns,          // getaddrinfo, cache hits are not counted
+    Connect,      // TCP connect race till the winning address
+    TlsHandshake, // full or resumed
+    FirstByte,    // request sent till the response headers are in
+    Body,         // headers till the last body byte
+};
+
+enum class Counter
+{
+    BytesReceived,
+    Reads,
+    ReadWaits,     // a non-blocking read found nothing and had to wait for the socket
+    ReadThrottled, // a read had to wait for the rate limit
+    BytesWritten,
+    Writes,
+    NetworkStallMicros, // the network side waited for a free pipeline buffer
+    WriterStallMicros,  // the writer waited for a filled buffer
+    ConnectionsOpened,
+    ConnectionsReused,
+    TlsFullHandshakes,
+    TlsResumedHandshakes,
+    TlsKernelReceive, // TLS connections whose records the kernel decrypts (kTLS)
+    TlsUserReceive,   // TLS connections decrypted by OpenSSL in user space
+    DownloadsCompleted,
+    DownloadsFailed,
+};
+
+#define METRICS_PHASES 5
+#define METRICS_COUNTERS 16
+
+enum class MetricsFormat
+{
+    Json,
+    Prometheus,
+};
+
+// counts of observations per upper bound, the last bucket takes everything above
+class Histogram
+{
+    std::vector<double> bounds;
+    std::unique_ptr<std::atomic<uint64_t>[]> counts; // bounds.size() + 1 buckets
+    std::atomic<uint64_t> count;
+    std::atomic<double> sum;
+
+public:
+    explicit Histogram(std::vector<double> bounds);
+
+    void observe(double value);
+    const std::vector<double> &getBounds() const;
+    uint64_t getBucket(size_t i) const; // not cumulative
+    uint64_t getCount() const;
+    double getSum() const;
+};
+
+// when the steps of one download happened, in ms since the process started
+struct TransferRecord
+{
+    std::string url;
+    double startMs = -1;
+    double connectedMs = -1;
+    double requestSentMs = -1;
+    double firstByteMs = -1;
+    double finishedMs = -1;
+    size_t bytes = 0;
+    bool failed = false;
+};
+
+// counters and histograms of every transfer of the process. recording is a
+// relaxed atomic add so it is cheap enough for every read, the dump is built
+// only when asked for as JSON or as Prometheus text.
+class Metrics
+{
+    std::chrono::steady_clock::time_point startedAt;
+    std::array<std::atomic<uint64_t>, METRICS_COUNTERS> counters;
+    std::vector<std::unique_ptr<Histogram>> phases; // seconds, indexed by Phase
+    Histogram throughput;          // bytes per second of the bodies
+    std::vector<TransferRecord> transfers;
+    mutable std::mutex mutex;
+
+    Metrics();
+
+public:
+    Metrics(const Metrics &) = delete;
+    Metrics &operator=(const Metrics &) = delete;
+
+    static Metrics &instance();
+
+    void add(Counter counter, uint64_t n = 1);
+    uint64_t get(Counter counter) const;
+    void observe(Phase phase, std::chrono::steady_clock::duration elapsed);
+    void observeThroughput(size_t bytes, std::chrono::steady_clock::duration elapsed);
+    void record(const TransferRecord &transfer);
+    double msSinceStart(std::chrono::steady_clock::time_point at) const;
+
+    std::string toJson() const;
+    std::string toPrometheus() const;
+    void writeTo(const std::string &path, MetricsFormat format) const; // - for stdout
+};
+
+// stamps the steps of one download and hands them to Metrics when it ends
+class TransferTimer
+{
+    std::string url;
+    std::chrono::steady_clock::time_point startedAt, connectedAt, requestSentAt, firstByteAt;
+
+public:
+    explicit TransferTimer(const std::string &url = "");
+
+    void start();
+    void connected();
+    void requestSent();
+    void firstByte();
+    void finished(size_t bytes, bool failed);
+};
+
+MetricsFormat parseMetricsFormat(const std::string &value);
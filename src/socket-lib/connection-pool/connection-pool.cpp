@@ -0,0 +1,113 @@
+#include "connection-pool.hpp"
+
+ConnectionPool::ConnectionPool(std::chrono::milliseconds idleTimeout, size_t maxIdlePerHost)
+    : idle(), idleTimeout(idleTimeout), maxIdlePerHost(maxIdlePerHost), reused(0), created(0), mutex() {}
+
+ConnectionPool::~ConnectionPool()
+{
+    closeAll();
+}
+
+// newest idle connection first, it is the least likely to be closed by the server
+std::shared_ptr<ISocket> ConnectionPool::acquire(const ParsedUrl &url)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = idle.find(keyOf(url));
+    if (it == idle.end())
+        return nullptr;
+
+    auto now = std::chrono::steady_clock::now();
+    std::deque<IdleConnection> &connections = it->second;
+
+    while (!connections.empty())
+    {
+        IdleConnection connection = std::move(connections.back());
+        connections.pop_back();
+
+        // server closed it, sent something unexpected or it waited too long
+        if (now - connection.idleSince > idleTimeout || !connection.socket->isReusable())
+        {
+            connection.socket->closeConnection();
+            continue;
+        }
+
+        reused++;
+        Metrics::instance().add(Counter::ConnectionsReused);
+        return connection.socket;
+    }
+
+    return nullptr;
+}
+
+std::shared_ptr<ISocket> ConnectionPool::create(const ParsedUrl &url)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        created++;
+    }
+
+    return createSocket(url);
+}
+
+void ConnectionPool::release(const ParsedUrl &url, std::shared_ptr<ISocket> socket)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::deque<IdleConnection> &connections = idle[keyOf(url)];
+
+    // drop the oldest one when the host already has enough idle connections
+    if (connections.size() >= maxIdlePerHost)
+    {
+        connections.front().socket->closeConnection();
+        connections.pop_front();
+    }
+
+    connections.push_back({std::move(socket), std::chrono::steady_clock::now()});
+}
+
+// close the connections idle for longer than the timeout
+void ConnectionPool::closeExpired()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto now = std::chrono::steady_clock::now();
+
+    for (auto &[key, connections] : idle)
+    {
+        // the oldest ones are at the front
+        while (!connections.empty() && now - connections.front().idleSince > idleTimeout)
+        {
+            connections.front().socket->closeConnection();
+            connections.pop_front();
+        }
+    }
+}
+
+void ConnectionPool::closeAll()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (auto &[key, connections] : idle)
+        for (IdleConnection &connection : connections)
+            connection.socket->closeConnection();
+
+    idle.clear();
+}
+
+size_t ConnectionPool::getReused() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return reused;
+}
+
+size_t ConnectionPool::getCreated() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return created;
+}
+
+// connections are only shared between urls with the same scheme, host and port
+std::string ConnectionPool::keyOf(const ParsedUrl &url)
+{
+    return url.scheme + "://" + url.host + ":" + url.port;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "../isocket/isocket.hpp"
+#include "../socket-factory/socket-factory.hpp"
+#include "../../utils/utils.hpp"
+#include "../../metrics/transfer-metrics/transfer-metrics.hpp"
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#define POOL_IDLE_TIMEOUT_MS 30000 // 30s se zyada idle connections band kar do
+#define POOL_MAX_IDLE_PER_HOST 8   // idle connections kept for one scheme/host/port
+
+// a connected socket waiting for its next request
+struct IdleConnection
+{
+    std::shared_ptr<ISocket> socket;
+    std::chrono::steady_clock::time_point idleSince;
+};
+
+// keeps the connections of finished keep-alive responses so the next request
+// to the same scheme, host and port skips the TCP and TLS handshakes
+class ConnectionPool
+{
+    std::unordered_map<std::string, std::deque<IdleConnection>> idle;
+    std::chrono::milliseconds idleTimeout;
+    size_t maxIdlePerHost;
+    size_t reused;  // checkouts served from the pool
+    size_t created; // checkouts that needed a new connection
+    mutable std::mutex mutex;
+
+public:
+    ConnectionPool(std::chrono::milliseconds idleTimeout = std::chrono::milliseconds(POOL_IDLE_TIMEOUT_MS),
+                   size_t maxIdlePerHost = POOL_MAX_IDLE_PER_HOST);
+    ~ConnectionPool();
+    ConnectionPool(const ConnectionPool &) = delete;
+    ConnectionPool &operator=(const ConnectionPool &) = delete;
+
+    // an idle healthy connection to the url's server, nullptr when there is none
+    std::shared_ptr<ISocket> acquire(const ParsedUrl &url);
+    // a new unconnected socket, counted as a pool miss
+    std::shared_ptr<ISocket> create(const ParsedUrl &url);
+    // hand back a connection whose last response was read completely
+    void release(const ParsedUrl &url, std::shared_ptr<ISocket> socket);
+
+    void closeExpired();
+    void closeAll();
+    size_t getReused() const;
+    size_t getCreated() const;
+
+    static std::string keyOf(const ParsedUrl &url);
+};
@@ -0,0 +1,168 @@
+#include "dns-cache.hpp"
+
+bool ResolvedAddress::operator==(const ResolvedAddress &other) const
+{
+    return family == other.family && length == other.length && memcmp(&address, &other.address, length) == 0;
+}
+
+// printable ip of the address
+std::string ResolvedAddress::toString() const
+{
+    char ip[INET6_ADDRSTRLEN] = {0};
+
+    if (family == AF_INET6)
+        inet_ntop(AF_INET6, &reinterpret_cast<const sockaddr_in6 *>(&address)->sin6_addr, ip, sizeof(ip));
+    else
+        inet_ntop(AF_INET, &reinterpret_cast<const sockaddr_in *>(&address)->sin_addr, ip, sizeof(ip));
+
+    return ip;
+}
+
+DnsCache::DnsCache() : entries(), ttl(DNS_CACHE_TTL_SECONDS), mutex() {}
+
+DnsCache &DnsCache::instance()
+{
+    static DnsCache cache;
+    return cache;
+}
+
+std::optional<std::vector<ResolvedAddress>> DnsCache::cached(const std::string &host, const std::string &port)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = entries.find(host + ":" + port);
+    if (it == entries.end() || it->second.expiresAt <= std::chrono::steady_clock::now())
+        return std::nullopt;
+
+    std::vector<ResolvedAddress> addresses = it->second.addresses;
+    if (it->second.preferred)
+    {
+        std::erase(addresses, *it->second.preferred);
+        addresses.insert(addresses.begin(), *it->second.preferred);
+    }
+    return addresses;
+}
+
+std::vector<ResolvedAddress> DnsCache::resolve(const std::string &host, const std::string &port)
+{
+    std::string key = host + ":" + port;
+    auto now = std::chrono::steady_clock::now();
+    std::optional<ResolvedAddress> preferred;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto it = entries.find(key);
+        if (it != entries.end() && it->second.expiresAt > now)
+        {
+            std::vector<ResolvedAddress> addresses = it->second.addresses;
+            preferred = it->second.preferred;
+
+            // winner pehle try karo
+            if (preferred)
+            {
+                std::erase(addresses, *preferred);
+                addresses.insert(addresses.begin(), *preferred);
+            }
+            return addresses;
+        }
+
+        if (it != entries.end())
+            preferred = it->second.preferred;
+    }
+
+    // resolve without holding the lock, other hosts shouldnt wait for this one
+    auto lookupStart = std::chrono::steady_clock::now();
+    std::vector<ResolvedAddress> addresses = interleave(lookup(host, port));
+    Metrics::instance().observe(Phase::Dns, std::chrono::steady_clock::now() - lookupStart);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry &entry = entries[key];
+    entry.addresses = addresses;
+    entry.expiresAt = now + ttl;
+
+    // the old winner only counts while the host still resolves to it
+    if (preferred && std::find(addresses.begin(), addresses.end(), *preferred) != addresses.end())
+    {
+        entry.preferred = preferred;
+        std::erase(addresses, *preferred);
+        addresses.insert(addresses.begin(), *preferred);
+    }
+    else
+        entry.preferred.reset();
+
+    return addresses;
+}
+
+void DnsCache::rememberWinner(const std::string &host, const std::string &port, const ResolvedAddress &address)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = entries.find(host + ":" + port);
+    if (it != entries.end())
+        it->second.preferred = address;
+}
+
+void DnsCache::forget(const std::string &host, const std::string &port)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.erase(host + ":" + port);
+}
+
+void DnsCache::setTtl(std::chrono::seconds newTtl)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    ttl = newTtl;
+}
+
+// resolve the host to its IPv6 and IPv4 addresses, sorted by getaddrinfo as in RFC 6724
+std::vector<ResolvedAddress> DnsCache::lookup(const std::string &host, const std::string &port)
+{
+    struct addrinfo hints{}, *res;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_ADDRCONFIG;
+
+    int status = getaddrinfo(host.c_str(), port.c_str(), &hints, &res);
+    if (status != 0)
+        throw std::runtime_error("getaddrinfo error: " + std::string(gai_strerror(status)));
+
+    std::vector<ResolvedAddress> addresses;
+    for (const struct addrinfo *temp = res; temp != nullptr; temp = temp->ai_next)
+    {
+        ResolvedAddress address;
+        address.family = temp->ai_family;
+        address.length = temp->ai_addrlen;
+        memcpy(&address.address, temp->ai_addr, temp->ai_addrlen);
+
+        if (std::find(addresses.begin(), addresses.end(), address) == addresses.end())
+            addresses.push_back(address);
+    }
+
+    freeaddrinfo(res);
+    return addresses;
+}
+
+// alternate the families starting with the first one, so a broken IPv6 path
+// costs only one attempt delay before IPv4 is tried (RFC 8305 section 4)
+std::vector<ResolvedAddress> DnsCache::interleave(const std::vector<ResolvedAddress> &addresses)
+{
+    if (addresses.empty())
+        return addresses;
+
+    int firstFamily = addresses.front().family;
+    std::vector<ResolvedAddress> first, second, ordered;
+
+    for (const ResolvedAddress &address : addresses)
+        (address.family == firstFamily ? first : second).push_back(address);
+
+    for (size_t i = 0; i < std::max(first.size(), second.size()); i++)
+    {
+        if (i < first.size())
+            ordered.push_back(first[i]);
+        if (i < second.size())
+            ordered.push_back(second[i]);
+    }
+
+    return ordered;
+}
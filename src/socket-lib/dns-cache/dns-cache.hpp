@@ -0,0 +1,65 @@
+#pragma once
+
+#include "../../metrics/transfer-metrics/transfer-metrics.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <sys/socket.h>
+
+#define DNS_CACHE_TTL_SECONDS 60 // getaddrinfo doesnt tell the record TTL, resolved addresses live this long
+
+// one resolved address of a host
+struct ResolvedAddress
+{
+    int family = AF_UNSPEC;
+    sockaddr_storage address{};
+    socklen_t length = 0;
+
+    bool operator==(const ResolvedAddress &other) const;
+    std::string toString() const;
+};
+
+// resolved addresses shared by every connection of the process, keyed by
+// host:port. getaddrinfo gives no TTL so entries expire after a configurable
+// time. the address that won the last connection race of a host is tried first.
+class DnsCache
+{
+    struct Entry
+    {
+        std::vector<ResolvedAddress> addresses;
+        std::chrono::steady_clock::time_point expiresAt;
+        std::optional<ResolvedAddress> preferred; // last address a connection succeeded on
+    };
+
+    std::unordered_map<std::string, Entry> entries;
+    std::chrono::seconds ttl;
+    std::mutex mutex;
+
+    DnsCache();
+
+public:
+    DnsCache(const DnsCache &) = delete;
+    DnsCache &operator=(const DnsCache &) = delete;
+
+    static DnsCache &instance();
+
+    // addresses in the order to try them: the remembered winner, then IPv6 and IPv4 interleaved
+    std::vector<ResolvedAddress> resolve(const std::string &host, const std::string &port);
+    // same order without a lookup, nothing when the host isnt cached or has expired
+    std::optional<std::vector<ResolvedAddress>> cached(const std::string &host, const std::string &port);
+    void rememberWinner(const std::string &host, const std::string &port, const ResolvedAddress &address);
+    void forget(const std::string &host, const std::string &port); // none of the addresses worked
+    void setTtl(std::chrono::seconds ttl);
+
+private:
+    static std::vector<ResolvedAddress> lookup(const std::string &host, const std::string &port);
+    static std::vector<ResolvedAddress> interleave(const std::vector<ResolvedAddress> &addresses);
+};
@@ -1,6 +1,18 @@
 #pragma once
 
 #include <string>
+#include <string_view>
+#include <span>
+#include <sys/uio.h>
+
+// outcome of a non-blocking socket operation
+enum class IoStatus
+{
+    Done,      // finished, a receive of 0 bytes means the peer closed
+    WantRead,  // retry once the fd is readable
+    WantWrite, // retry once the fd is writable
+    WantTime,  // retry after a delay, the read rate limit is used up for now
+};
 
 class ISocket
 {
@@ -11,6 +23,17 @@ public:
     virtual void sendAll(const std::string &data) = 0;
     virtual std::string receiveAll() = 0;
     virtual std::string receiveSome(const int size) = 0;
+    virtual size_t receiveInto(std::span<char> buffer) = 0;               // reads into the caller's buffer, 0 when the peer closed
+    virtual size_t receiveInto(const struct iovec *iov, const int iovcnt) = 0; // scatter read over the caller's buffers
+    virtual int getRawFd() const = 0; // fd carrying the payload as is, -1 when bytes need user space processing
+
+    // non-blocking operations for event loops, none of them waits for the peer
+    virtual void setNonBlocking(bool enabled) = 0;
+    virtual IoStatus connectStep() = 0; // starts or continues connecting, call again when the fd is ready
+    virtual IoStatus trySend(std::string_view data, size_t &sent) = 0;
+    virtual IoStatus tryReceive(std::span<char> buffer, size_t &received) = 0;
+    virtual int getPollFd() const = 0; // fd to wait on, changes while connecting tries other addresses
+    virtual bool isReusable() = 0;     // an idle connection is still open and has nothing unread
     virtual void closeConnection() = 0;
     virtual ~ISocket();
 };
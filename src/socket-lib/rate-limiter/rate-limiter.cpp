@@ -0,0 +1,318 @@
+#include "rate-limiter.hpp"
+
+TokenBucket::TokenBucket(const RateLimit &limit)
+    : limit(), capacity(0), tokens(0), refilledAt(std::chrono::steady_clock::now()), mutex()
+{
+    setLimit(limit); // a fresh bucket lets the first burst through
+}
+
+void TokenBucket::setLimit(const RateLimit &newLimit)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // bytes earned at the old rate are kept
+    refill(std::chrono::steady_clock::now());
+
+    // an unlimited bucket counts as full
+    bool wasUnlimited = limit.bytesPerSecond == 0;
+
+    limit = newLimit;
+    capacity = limit.burst > 0 ? limit.burst : std::max<size_t>(limit.bytesPerSecond, RATE_LIMIT_MIN_BURST);
+    tokens = wasUnlimited ? capacity : std::min(tokens, capacity);
+}
+
+void TokenBucket::refill(std::chrono::steady_clock::time_point now)
+{
+    double seconds = std::chrono::duration<double>(now - refilledAt).count();
+    refilledAt = now;
+    tokens = std::min(capacity, tokens + seconds * limit.bytesPerSecond);
+}
+
+// either nothing or at least a minimum amount, tiny reads would cost more than they save
+size_t TokenBucket::allowance(size_t wanted)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (limit.bytesPerSecond == 0)
+        return wanted;
+
+    refill(std::chrono::steady_clock::now());
+
+    double least = std::min({(double)wanted, capacity, (double)RATE_LIMIT_MIN_BURST});
+    if (tokens < least)
+        return 0;
+
+    return std::min(wanted, (size_t)tokens);
+}
+
+// readers sharing a bucket may take a little more than there is, the debt is paid by waiting
+void TokenBucket::consume(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (limit.bytesPerSecond > 0)
+        tokens -= bytes;
+}
+
+std::chrono::milliseconds TokenBucket::delay(size_t wanted)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (limit.bytesPerSecond == 0)
+        return std::chrono::milliseconds(0);
+
+    refill(std::chrono::steady_clock::now());
+
+    double least = std::min({(double)wanted, capacity, (double)RATE_LIMIT_MIN_BURST});
+    if (tokens >= least)
+        return std::chrono::milliseconds(0);
+
+    double ms = (least - tokens) * 1000 / limit.bytesPerSecond;
+    return std::chrono::milliseconds((long long)ms + 1);
+}
+
+RateLimiter::RateLimiter(std::vector<std::shared_ptr<TokenBucket>> buckets) : buckets(std::move(buckets)) {}
+
+size_t RateLimiter::allowance(size_t wanted)
+{
+    // picks up a changed limit file while the download runs
+    RateLimits::instance().poll();
+
+    for (const std::shared_ptr<TokenBucket> &bucket : buckets)
+        wanted = std::min(wanted, bucket->allowance(wanted));
+    return wanted;
+}
+
+void RateLimiter::consume(size_t bytes)
+{
+    for (const std::shared_ptr<TokenBucket> &bucket : buckets)
+        bucket->consume(bytes);
+}
+
+std::chrono::milliseconds RateLimiter::delay(size_t wanted)
+{
+    std::chrono::milliseconds longest(0);
+    for (const std::shared_ptr<TokenBucket> &bucket : buckets)
+        longest = std::max(longest, bucket->delay(wanted));
+    return longest;
+}
+
+RateLimits::RateLimits()
+    : base(), current(), globalBucket(std::make_shared<TokenBucket>()), hostBuckets(), downloadBuckets(),
+      limitFile(""), limitFileTime(), nextPollAt(0), mutex() {}
+
+RateLimits &RateLimits::instance()
+{
+    static RateLimits limits;
+    return limits;
+}
+
+void RateLimits::setGlobalRate(const RateLimit &limit)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    base.global = current.global = limit;
+    apply(current);
+}
+
+void RateLimits::setPerHostRate(const RateLimit &limit)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    base.perHost = current.perHost = limit;
+    apply(current);
+}
+
+void RateLimits::setHostRate(const std::string &host, const RateLimit &limit)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    base.hosts[host] = current.hosts[host] = limit;
+    apply(current);
+}
+
+void RateLimits::setDownloadRate(const RateLimit &limit)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    base.download = current.download = limit;
+    apply(current);
+}
+
+// read the limits from path now and again whenever it is modified
+void RateLimits::watchFile(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    limitFile = path;
+    limitFileTime = std::filesystem::file_time_type();
+    reloadFile();
+}
+
+std::shared_ptr<RateLimiter> RateLimits::forDownload(const std::string &host)
+{
+    poll();
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // forget the buckets of finished downloads
+    std::erase_if(downloadBuckets, [](const std::weak_ptr<TokenBucket> &bucket)
+                  { return bucket.expired(); });
+
+    auto own = std::make_shared<TokenBucket>(current.download);
+    downloadBuckets.push_back(own);
+
+    return std::make_shared<RateLimiter>(std::vector<std::shared_ptr<TokenBucket>>{own, hostBucket(host), globalBucket});
+}
+
+// false when nothing can slow down a download from host, not even a later change of the limit file
+bool RateLimits::isLimited(const std::string &host)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return !limitFile.empty() || current.global.bytesPerSecond > 0 || current.download.bytesPerSecond > 0 ||
+           hostLimit(current, host).bytesPerSecond > 0;
+}
+
+void RateLimits::poll()
+{
+    long long now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::steady_clock::now().time_since_epoch())
+                        .count();
+
+    // only one reader checks the file per interval
+    long long due = nextPollAt.load();
+    if (now < due || !nextPollAt.compare_exchange_strong(due, now + RATE_LIMIT_FILE_POLL_MS))
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (limitFile.empty())
+        return;
+
+    std::error_code ec;
+    std::filesystem::file_time_type modified = std::filesystem::last_write_time(limitFile, ec);
+    if (!ec && modified != limitFileTime)
+        reloadFile();
+}
+
+// parse the limit file over the limits of the options, a bad line is skipped
+void RateLimits::reloadFile()
+{
+    std::error_code ec;
+    limitFileTime = std::filesystem::last_write_time(limitFile, ec);
+
+    std::ifstream input(limitFile);
+    if (!input)
+    {
+        std::clog << "cannot read the limit file " << limitFile << ", keeping the current limits" << std::endl;
+        return;
+    }
+
+    Config config = base;
+    std::string line;
+    int lineNo = 0;
+
+    while (std::getline(input, line))
+    {
+        lineNo++;
+
+        // Comment aur khali lines chhod do
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        std::vector<std::string> words;
+        for (std::string word; fields >> word;)
+            words.push_back(word);
+
+        if (words.empty())
+            continue;
+
+        try
+        {
+            bool isHost = words[0] == "host";
+            if (!isHost && words[0] != "global" && words[0] != "per-host" && words[0] != "download")
+                throw std::runtime_error("unknown limit " + words[0]);
+
+            size_t first = isHost ? 2 : 1;
+            if (words.size() < first + 1 || words.size() > first + 2)
+                throw std::runtime_error("expected a rate and an optional burst");
+
+            RateLimit limit;
+            limit.bytesPerSecond = parseRate(words[first]);
+            limit.burst = words.size() > first + 1 ? parseRate(words[first + 1]) : 0;
+
+            if (isHost)
+                config.hosts[words[1]] = limit;
+            else if (words[0] == "global")
+                config.global = limit;
+            else if (words[0] == "per-host")
+                config.perHost = limit;
+            else
+                config.download = limit;
+        }
+        catch (const std::exception &e)
+        {
+            std::clog << limitFile << ":" << lineNo << ": " << e.what() << ", line ignored" << std::endl;
+        }
+    }
+
+    current = config;
+    apply(current);
+    std::clog << "rate limits loaded from " << limitFile << std::endl;
+}
+
+// push the limits to the buckets in use
+void RateLimits::apply(const Config &config)
+{
+    globalBucket->setLimit(config.global);
+
+    for (auto &[host, bucket] : hostBuckets)
+        bucket->setLimit(hostLimit(config, host));
+
+    for (const std::weak_ptr<TokenBucket> &weak : downloadBuckets)
+    {
+        if (std::shared_ptr<TokenBucket> bucket = weak.lock())
+            bucket->setLimit(config.download);
+    }
+}
+
+RateLimit RateLimits::hostLimit(const Config &config, const std::string &host) const
+{
+    auto it = config.hosts.find(host);
+    return it != config.hosts.end() ? it->second : config.perHost;
+}
+
+std::shared_ptr<TokenBucket> RateLimits::hostBucket(const std::string &host)
+{
+    std::shared_ptr<TokenBucket> &bucket = hostBuckets[host];
+    if (!bucket)
+        bucket = std::make_shared<TokenBucket>(hostLimit(current, host));
+    return bucket;
+}
+
+size_t parseRate(const std::string &value)
+{
+    size_t consumed = 0;
+    double number = -1;
+
+    try
+    {
+        number = std::stod(value, &consumed);
+    }
+    catch (const std::exception &)
+    {
+        consumed = 0;
+    }
+
+    std::string suffix = value.substr(consumed);
+    double multiplier = 1;
+
+    if (suffix == "k" || suffix == "K")
+        multiplier = 1024;
+    else if (suffix == "m" || suffix == "M")
+        multiplier = 1024 * 1024;
+    else if (suffix == "g" || suffix == "G")
+        multiplier = 1024 * 1024 * 1024;
+    else if (!suffix.empty())
+        consumed = 0;
+
+    if (consumed == 0 || number < 0)
+        throw std::runtime_error("invalid rate '" + value + "'");
+
+    return (size_t)(number * multiplier);
+}
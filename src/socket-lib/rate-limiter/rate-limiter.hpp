@@ -0,0 +1,120 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define RATE_LIMIT_MIN_BURST 16384   // a bucket holds at least this much so reads dont shrink to a few bytes
+#define RATE_LIMIT_FILE_POLL_MS 1000 // how often the limit file is checked for changes
+
+// a read rate, 0 bytes per second means unlimited
+struct RateLimit
+{
+    size_t bytesPerSecond = 0;
+    size_t burst = 0; // bytes allowed at once after being idle, 0 for one second worth of the rate
+
+    bool operator==(const RateLimit &other) const = default;
+};
+
+// bytes fill up at the rate till the bucket holds burst bytes, a read takes
+// them out. the rate can be changed while readers are using the bucket.
+class TokenBucket
+{
+    RateLimit limit;
+    double capacity;
+    double tokens;
+    std::chrono::steady_clock::time_point refilledAt;
+    std::mutex mutex;
+
+public:
+    explicit TokenBucket(const RateLimit &limit = RateLimit());
+
+    void setLimit(const RateLimit &limit);
+    size_t allowance(size_t wanted);              // bytes that may be read right now
+    void consume(size_t bytes);                   // bytes that were actually read
+    std::chrono::milliseconds delay(size_t wanted); // wait till a read of wanted bytes is allowed
+
+private:
+    void refill(std::chrono::steady_clock::time_point now);
+};
+
+// the buckets one download reads through: its own, the one of its host and
+// the global one. all of them have to allow a read.
+class RateLimiter
+{
+    std::vector<std::shared_ptr<TokenBucket>> buckets;
+
+public:
+    explicit RateLimiter(std::vector<std::shared_ptr<TokenBucket>> buckets);
+
+    size_t allowance(size_t wanted);
+    void consume(size_t bytes);
+    std::chrono::milliseconds delay(size_t wanted);
+};
+
+// every limit of the process. the limits set by the options can be changed
+// at runtime through the setters or by a limit file, which is read again
+// whenever its modification time changes. lines of the file look like
+//   global 10M
+//   host example.com 2M 4M
+//   per-host 5M
+//   download 1M
+// and override the options for as long as they are in the file.
+class RateLimits
+{
+    struct Config
+    {
+        RateLimit global;
+        RateLimit perHost; // for hosts without their own limit
+        RateLimit download;
+        std::unordered_map<std::string, RateLimit> hosts;
+    };
+
+    Config base;    // set through the setters
+    Config current; // base with the limit file applied
+    std::shared_ptr<TokenBucket> globalBucket;
+    std::unordered_map<std::string, std::shared_ptr<TokenBucket>> hostBuckets;
+    std::vector<std::weak_ptr<TokenBucket>> downloadBuckets;
+    std::string limitFile;
+    std::filesystem::file_time_type limitFileTime;
+    std::atomic<long long> nextPollAt; // steady clock ms
+    std::mutex mutex;
+
+    RateLimits();
+
+public:
+    RateLimits(const RateLimits &) = delete;
+    RateLimits &operator=(const RateLimits &) = delete;
+
+    static RateLimits &instance();
+
+    void setGlobalRate(const RateLimit &limit);
+    void setPerHostRate(const RateLimit &limit);
+    void setHostRate(const std::string &host, const RateLimit &limit);
+    void setDownloadRate(const RateLimit &limit);
+    void watchFile(const std::string &path);
+
+    // limiter for a new download from host, every download gets its own bucket
+    std::shared_ptr<RateLimiter> forDownload(const std::string &host);
+    bool isLimited(const std::string &host);
+    void poll(); // reloads the limit file when it changed, cheap to call on every read
+
+private:
+    void reloadFile();
+    void apply(const Config &config);
+    RateLimit hostLimit(const Config &config, const std::string &host) const;
+    std::shared_ptr<TokenBucket> hostBucket(const std::string &host);
+};
+
+// "500K", "10M", "1G" or plain bytes per second, suffixes are powers of 1024
+size_t parseRate(const std::string &value);
@@ -0,0 +1,10 @@
+#include "socket-factory.hpp"
+
+// create a TLS socket for https urls and a plain TCP socket otherwise
+std::shared_ptr<ISocket> createSocket(const ParsedUrl &url)
+{
+    if (url.scheme == "https")
+        return std::make_shared<SslSocket>(url.host, url.port);
+
+    return std::make_shared<TcpSocket>(url.host, url.port);
+}
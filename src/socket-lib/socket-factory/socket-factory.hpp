@@ -0,0 +1,9 @@
+#pragma once
+
+#include "../isocket/isocket.hpp"
+#include "../tcp-socket/tcp-socket.hpp"
+#include "../ssl-socket/ssl-socket.hpp"
+#include "../../utils/utils.hpp"
+#include <memory>
+
+std::shared_ptr<ISocket> createSocket(const ParsedUrl &url);
@@ -2,7 +2,8 @@
 
 // create a SSL socket from the provided host and port
 SslSocket::SslSocket(const std::string &host, const std::string &port)
-    : host(host), port(port), ctx(nullptr), ssl(nullptr), sockfd(-1) {}
+    : host(host), port(port), sessionKey(host + ":" + port), ssl(nullptr), sockfd(-1), connector(host, port), nonBlocking(false),
+      kernelReceive(false), handshakeStartedAt() {}
 
 SslSocket::~SslSocket()
 {
@@ -12,65 +13,16 @@ SslSocket::~SslSocket()
 // create a secure TLS connection to server
 void SslSocket::connectToServer()
 {
-    OPENSSL_init_ssl(0, nullptr);
-
-    ctx = SSL_CTX_new(TLS_client_method());
-    if (!ctx)
-    {
-        ERR_print_errors_fp(stderr);
-        throw std::runtime_error("failed to create ssl context!");
-    }
-
-    // currently dont verify certificate
-    SSL_CTX_set_verify(ctx, SSL_VERIFY_NONE, nullptr);
-
-    struct addrinfo hints{}, *res;
-    hints.ai_family = AF_INET;
-    hints.ai_socktype = SOCK_STREAM;
-
-    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &res) != 0)
-        throw std::runtime_error("getaddrinfo failed");
-
-    const struct addrinfo *temp = res;
-    while (temp != nullptr)
-    {
-        int sockfd_temp = socket(temp->ai_family, temp->ai_socktype, temp->ai_protocol);
-        if (sockfd_temp < 0)
-        {
-            temp = temp->ai_next;
-            continue;
-        }
-
-        if (::connect(sockfd_temp, temp->ai_addr, temp->ai_addrlen) == 0)
-        {
-            sockfd = sockfd_temp; // Success => save
-            break;
-        }
-
-        close(sockfd_temp);
-        temp = temp->ai_next;
-    }
-
-    freeaddrinfo(res);
-
-    if (temp == nullptr)
-        throw std::runtime_error("TCP handshake failed");
-
-    ssl = SSL_new(ctx);
-    SSL_set_fd(ssl, sockfd);
-
-    if (!SSL_set_tlsext_host_name(ssl, host.c_str()))
-    {
-        ERR_print_errors_fp(stderr);
-        throw std::runtime_error("Failed to set TLS hostname (SNI)");
-    }
+    sockfd = connector.connect();
+    createSsl();
 
     if (SSL_connect(ssl) <= 0)
     {
         ERR_print_errors_fp(stderr);
         throw std::runtime_error("TLS handshake failed");
     }
-    std::clog << "securely connected to server" << std::endl;
+    recordHandshake();
+    std::clog << "securely connected to server" << (kernelReceive ? " with kernel TLS receive" : "") << std::endl;
 }
 
 // send the provided data to the peer
@@ -114,33 +66,217 @@ std::string SslSocket::receiveAll()
     return result;
 }
 
-// recieve some specified amount of data
+// recieve at most the specified amount of data
 std::string SslSocket::receiveSome(const int size)
 {
-    std::string result;
-    char buffer[1024];
-    int bytesRead;
-    int totalBytesRead = 0;
+    std::string result(size, '\0');
+    size_t bytesRead = receiveInto(std::span<char>(result.data(), result.size()));
+    result.resize(bytesRead);
+    return result;
+}
 
-    // read only the needed amount of data
-    while (totalBytesRead < size)
+// decrypt the next available bytes directly into the provided buffer
+size_t SslSocket::receiveInto(std::span<char> buffer)
+{
+    size_t bytesRead = 0;
+
+    if (SSL_read_ex(ssl, buffer.data(), buffer.size(), &bytesRead) == 1)
+        return bytesRead;
+
+    // peer has closed the connection
+    if (isPeerClosed(SSL_get_error(ssl, 0)))
+        return 0;
+
+    ERR_print_errors_fp(stderr);
+    throw std::runtime_error("SSL_read failed");
+}
+
+// fill the buffers one after another, continues only with already decrypted bytes
+size_t SslSocket::receiveInto(const struct iovec *iov, const int iovcnt)
+{
+    size_t totalBytesRead = 0;
+
+    for (int i = 0; i < iovcnt; i++)
     {
-        bytesRead = SSL_read(ssl, buffer, sizeof(buffer));
-        if (bytesRead > 0)
-        {
-            result.append(buffer, bytesRead);
-            totalBytesRead += bytesRead;
-        }
+        // dont block for more once something has been read
+        if (totalBytesRead > 0 && SSL_pending(ssl) == 0)
+            break;
 
-        if (bytesRead < 0)
-        {
-            ERR_print_errors_fp(stderr);
-            throw std::runtime_error("SSL_read failed");
-        }
-        else
+        size_t bytesRead = receiveInto(std::span<char>(static_cast<char *>(iov[i].iov_base), iov[i].iov_len));
+        totalBytesRead += bytesRead;
+
+        if (bytesRead < iov[i].iov_len)
             break;
     }
-    return result;
+
+    return totalBytesRead;
+}
+
+// the socket carries encrypted records which only SSL_read can make sense of, unless
+// the kernel decrypts them and OpenSSL holds back nothing already read. even then a
+// non-data record (close_notify) fails a plain read with EIO, so the caller must
+// know where the body ends
+int SslSocket::getRawFd() const
+{
+    if (kernelReceive && ssl && !SSL_has_pending(ssl))
+        return sockfd;
+    return -1;
+}
+
+// switch the socket between blocking and non-blocking mode
+void SslSocket::setNonBlocking(bool enabled)
+{
+    this->nonBlocking = enabled;
+
+    if (sockfd < 0)
+        return;
+
+    int flags = fcntl(sockfd, F_GETFL);
+    fcntl(sockfd, F_SETFL, enabled ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK));
+}
+
+// connect the TCP socket and then run the TLS handshake without blocking
+IoStatus SslSocket::connectStep()
+{
+    if (sockfd < 0)
+    {
+        IoStatus status = connector.connectStep(sockfd);
+        if (status != IoStatus::Done)
+            return status;
+
+        setNonBlocking(nonBlocking);
+        createSsl();
+    }
+
+    int ret = SSL_connect(ssl);
+    if (ret == 1)
+    {
+        recordHandshake();
+        return IoStatus::Done;
+    }
+
+    return statusOf(ret, "TLS handshake failed");
+}
+
+// encrypt and send as much as the socket takes right now
+IoStatus SslSocket::trySend(std::string_view data, size_t &sent)
+{
+    sent = 0;
+    while (sent < data.size())
+    {
+        size_t written = 0;
+        int ret = SSL_write_ex(ssl, data.data() + sent, data.size() - sent, &written);
+        if (ret != 1)
+            return statusOf(ret, "SSL_write failed");
+
+        sent += written;
+    }
+    return IoStatus::Done;
+}
+
+// decrypt what is available right now
+IoStatus SslSocket::tryReceive(std::span<char> buffer, size_t &received)
+{
+    received = 0;
+
+    int ret = SSL_read_ex(ssl, buffer.data(), buffer.size(), &received);
+    if (ret == 1)
+        return IoStatus::Done;
+
+    // peer has closed the connection
+    if (isPeerClosed(SSL_get_error(ssl, ret)))
+    {
+        received = 0;
+        return IoStatus::Done;
+    }
+
+    return statusOf(ret, "SSL_read failed");
+}
+
+// the connected socket or the one still connecting
+int SslSocket::getPollFd() const
+{
+    return sockfd >= 0 ? sockfd : connector.getPendingFd();
+}
+
+// create the TLS session over the connected socket, the context is shared
+void SslSocket::createSsl()
+{
+    ssl = TlsContext::instance().newSsl(sessionKey);
+    SSL_set_fd(ssl, sockfd);
+    handshakeStartedAt = std::chrono::steady_clock::now();
+
+    if (!SSL_set_tlsext_host_name(ssl, host.c_str()))
+    {
+        ERR_print_errors_fp(stderr);
+        throw std::runtime_error("Failed to set TLS hostname (SNI)");
+    }
+}
+
+// keep the session for resumption and count the handshake
+void SslSocket::recordHandshake()
+{
+    TlsContext::instance().recordHandshake(ssl);
+
+    Metrics &metrics = Metrics::instance();
+    metrics.observe(Phase::TlsHandshake, std::chrono::steady_clock::now() - handshakeStartedAt);
+    metrics.add(SSL_session_reused(ssl) ? Counter::TlsResumedHandshakes : Counter::TlsFullHandshakes);
+
+    // OpenSSL hands the keys to the kernel at the end of the handshake when it can
+    kernelReceive = BIO_get_ktls_recv(SSL_get_rbio(ssl));
+    metrics.add(kernelReceive ? Counter::TlsKernelReceive : Counter::TlsUserReceive);
+}
+
+// whether a failed read means the peer closed (cleanly or without close_notify)
+bool SslSocket::isPeerClosed(int err)
+{
+    if (err == SSL_ERROR_ZERO_RETURN ||
+        (err == SSL_ERROR_SYSCALL && ERR_peek_error() == 0) ||
+        (err == SSL_ERROR_SSL && ERR_GET_REASON(ERR_peek_error()) == SSL_R_UNEXPECTED_EOF_WHILE_READING))
+    {
+        ERR_clear_error();
+        return true;
+    }
+    return false;
+}
+
+// map what OpenSSL wants next to the socket readiness to wait for
+IoStatus SslSocket::statusOf(int ret, const std::string &failure)
+{
+    int err = SSL_get_error(ssl, ret);
+
+    if (err == SSL_ERROR_WANT_READ)
+        return IoStatus::WantRead;
+    if (err == SSL_ERROR_WANT_WRITE)
+        return IoStatus::WantWrite;
+
+    ERR_print_errors_fp(stderr);
+    throw std::runtime_error(failure + " with error: " + std::to_string(err));
+}
+
+// like TCP, except that TLS 1.3 session tickets can arrive after the response
+// and leave the socket readable, peeking consumes them without app data
+bool SslSocket::isReusable()
+{
+    if (sockfd < 0 || !ssl)
+        return false;
+
+    pollfd pfd{sockfd, POLLIN, 0};
+    if (SSL_pending(ssl) == 0 && poll(&pfd, 1, 0) == 0)
+        return true;
+
+    bool wasNonBlocking = nonBlocking;
+    setNonBlocking(true);
+
+    char byte;
+    size_t peeked = 0;
+    int ret = SSL_peek_ex(ssl, &byte, 1, &peeked);
+    int err = SSL_get_error(ssl, ret);
+
+    setNonBlocking(wasNonBlocking);
+    ERR_clear_error();
+
+    return ret != 1 && err == SSL_ERROR_WANT_READ;
 }
 
 // securely close the ssl connection
@@ -150,22 +286,16 @@ void SslSocket::closeConnection()
     {
         SSL_shutdown(ssl);
         SSL_free(ssl);
-        OPENSSL_cleanup();
         ssl = nullptr;
         // std::clog << "ssl freed" << std::endl;
     }
 
-    if (ctx)
-    {
-        SSL_CTX_free(ctx);
-        ctx = nullptr;
-        // std::clog << "ctx freed" << std::endl;
-    }
-
     if (sockfd >= 0)
     {
         close(sockfd);
         sockfd = -1;
         // std::clog << "socket freed" << std::endl;
     }
+    kernelReceive = false;
+    connector.reset();
 }
\ No newline at end of file
@@ -1,21 +1,30 @@
 #pragma once
 
 #include "../isocket/isocket.hpp"
+#include "../tcp-connector/tcp-connector.hpp"
+#include "../tls-context/tls-context.hpp"
 #include <openssl/ssl.h>
 #include <openssl/err.h>
 #include <sys/socket.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <netdb.h>
 #include <stdexcept>
 #include <iostream>
+#include <chrono>
 
 class SslSocket : public ISocket
 {
     std::string host;
     std::string port;
-    SSL_CTX *ctx;
+    std::string sessionKey; // host:port the TLS sessions are cached under
     SSL *ssl;
     int sockfd;
+    TcpConnector connector;
+    bool nonBlocking;
+    bool kernelReceive; // kTLS decrypts the received records, the fd then carries plaintext
+    std::chrono::steady_clock::time_point handshakeStartedAt;
 
 public:
     SslSocket(const std::string &host, const std::string &port);
@@ -24,6 +33,21 @@ public:
     void connectToServer() override;
     std::string receiveAll() override;
     std::string receiveSome(const int size) override;
+    size_t receiveInto(std::span<char> buffer) override;
+    size_t receiveInto(const struct iovec *iov, const int iovcnt) override;
     void sendAll(const std::string &data) override;
+    int getRawFd() const override;
+    void setNonBlocking(bool enabled) override;
+    IoStatus connectStep() override;
+    IoStatus trySend(std::string_view data, size_t &sent) override;
+    IoStatus tryReceive(std::span<char> buffer, size_t &received) override;
+    int getPollFd() const override;
+    bool isReusable() override;
     void closeConnection() override;
+
+private:
+    void createSsl();
+    void recordHandshake();
+    bool isPeerClosed(int err);
+    IoStatus statusOf(int ret, const std::string &failure);
 };
\ No newline at end of file
@@ -0,0 +1,302 @@
+#include "tcp-connector.hpp"
+
+TcpConnector::TcpConnector(const std::string &h, const std::string &p)
+    : host(h), port(p), addresses(), nextAddress(0), attempts(), lookup(nullptr), nextAttemptAt(), raceStartedAt(), raceFd(-1), timerFd(-1),
+      lastError("") {}
+
+TcpConnector::~TcpConnector()
+{
+    reset();
+}
+
+TcpConnector::Lookup::~Lookup()
+{
+    if (eventFd >= 0)
+        close(eventFd);
+}
+
+// run the race till an address connects, returns the connected blocking fd
+int TcpConnector::connect()
+{
+    // the caller blocks anyway, so the lookup may as well run on its thread
+    DnsCache::instance().resolve(host, port);
+
+    int fd = -1;
+    while (connectStep(fd) != IoStatus::Done)
+    {
+        pollfd pfd{getPendingFd(), POLLIN, 0};
+        if (poll(&pfd, 1, -1) < 0 && errno != EINTR)
+            throw std::runtime_error(std::string("poll failed: ") + strerror(errno));
+    }
+
+    int flags = fcntl(fd, F_GETFL);
+    fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+    return fd;
+}
+
+// start the race on the first call, later calls pick up finished attempts and start new ones
+IoStatus TcpConnector::connectStep(int &fd)
+{
+    if (raceFd < 0)
+        begin();
+    if (!finishLookup())
+        return IoStatus::WantRead;
+
+    // clear the timer so the race fd only wakes up for the next deadline
+    uint64_t expirations;
+    while (read(timerFd, &expirations, sizeof(expirations)) > 0)
+        ;
+
+    if (finishAttempts(fd))
+        return IoStatus::Done;
+
+    auto now = std::chrono::steady_clock::now();
+    if (nextAddress < addresses.size() && (attempts.empty() || now >= nextAttemptAt))
+    {
+        startAttempt();
+
+        // connect can succeed right away on loopback
+        if (finishAttempts(fd))
+            return IoStatus::Done;
+    }
+
+    if (attempts.empty() && nextAddress == addresses.size())
+    {
+        std::string error = lastError;
+        DnsCache::instance().forget(host, port);
+        reset();
+        throw std::runtime_error("connection failed" + (error.empty() ? "" : ": " + error));
+    }
+
+    armTimer();
+    return IoStatus::WantRead;
+}
+
+int TcpConnector::getPendingFd() const
+{
+    return raceFd;
+}
+
+// close every attempt in progress
+void TcpConnector::reset()
+{
+    for (const Attempt &attempt : attempts)
+        close(attempt.fd);
+    attempts.clear();
+
+    if (timerFd >= 0)
+        close(timerFd);
+    if (raceFd >= 0)
+        close(raceFd);
+    timerFd = -1;
+    raceFd = -1;
+
+    // a running lookup finishes on its own and fills the cache
+    lookup.reset();
+    addresses.clear();
+    nextAddress = 0;
+    lastError.clear();
+}
+
+// set up the fds the race is watched with and take the addresses from the cache,
+// a host that isnt cached is looked up without blocking the caller
+void TcpConnector::begin()
+{
+    raceFd = epoll_create1(EPOLL_CLOEXEC);
+    timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (raceFd < 0 || timerFd < 0)
+    {
+        reset();
+        throw std::runtime_error(std::string("failed to set up the connect race: ") + strerror(errno));
+    }
+
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = timerFd;
+    epoll_ctl(raceFd, EPOLL_CTL_ADD, timerFd, &event);
+
+    if (std::optional<std::vector<ResolvedAddress>> known = DnsCache::instance().cached(host, port))
+    {
+        addresses = std::move(*known);
+        if (addresses.empty())
+        {
+            reset();
+            throw std::runtime_error("no address found for " + host);
+        }
+
+        raceStartedAt = std::chrono::steady_clock::now();
+        return;
+    }
+
+    lookup = std::make_shared<Lookup>();
+    lookup->eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (lookup->eventFd < 0)
+    {
+        reset();
+        throw std::runtime_error(std::string("failed to set up the dns lookup: ") + strerror(errno));
+    }
+
+    event.data.fd = lookup->eventFd;
+    epoll_ctl(raceFd, EPOLL_CTL_ADD, lookup->eventFd, &event);
+
+    std::thread([pending = lookup, host = host, port = port]()
+                {
+                    std::vector<ResolvedAddress> found;
+                    std::string error;
+                    try
+                    {
+                        found = DnsCache::instance().resolve(host, port);
+                    }
+                    catch (const std::exception &e)
+                    {
+                        error = e.what();
+                    }
+
+                    std::lock_guard<std::mutex> lock(pending->mutex);
+                    pending->addresses = std::move(found);
+                    pending->error = std::move(error);
+                    pending->done = true;
+
+                    uint64_t one = 1;
+                    if (write(pending->eventFd, &one, sizeof(one)) < 0)
+                        pending->error = "failed to signal the dns lookup"; })
+        .detach();
+}
+
+// take the addresses once the lookup thread is done, the race starts from there
+bool TcpConnector::finishLookup()
+{
+    if (!lookup)
+        return true;
+
+    std::string error;
+    {
+        std::lock_guard<std::mutex> lock(lookup->mutex);
+        if (!lookup->done)
+            return false;
+
+        addresses = std::move(lookup->addresses);
+        error = lookup->error;
+    }
+
+    epoll_ctl(raceFd, EPOLL_CTL_DEL, lookup->eventFd, nullptr);
+    lookup.reset();
+
+    if (!error.empty() || addresses.empty())
+    {
+        reset();
+        throw std::runtime_error(error.empty() ? "no address found for " + host : error);
+    }
+
+    raceStartedAt = std::chrono::steady_clock::now();
+    return true;
+}
+
+// connect the next address in the background
+void TcpConnector::startAttempt()
+{
+    while (nextAddress < addresses.size())
+    {
+        size_t index = nextAddress++;
+        const ResolvedAddress &address = addresses[index];
+
+        int fd = socket(address.family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+        {
+            lastError = strerror(errno);
+            continue;
+        }
+
+        if (::connect(fd, reinterpret_cast<const sockaddr *>(&address.address), address.length) < 0 &&
+            errno != EINPROGRESS)
+        {
+            lastError = address.toString() + " " + strerror(errno);
+            close(fd);
+            continue;
+        }
+
+        epoll_event event{};
+        event.events = EPOLLOUT;
+        event.data.fd = fd;
+        epoll_ctl(raceFd, EPOLL_CTL_ADD, fd, &event);
+
+        auto now = std::chrono::steady_clock::now();
+        attempts.push_back({fd, index, now});
+        nextAttemptAt = now + std::chrono::milliseconds(CONNECTION_ATTEMPT_DELAY_MS);
+        return;
+    }
+}
+
+// true with fd set when an attempt connected, failed and timed out attempts are dropped
+bool TcpConnector::finishAttempts(int &fd)
+{
+    auto now = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < attempts.size();)
+    {
+        pollfd pfd{attempts[i].fd, POLLOUT, 0};
+        if (poll(&pfd, 1, 0) == 0)
+        {
+            if (now - attempts[i].startedAt >= std::chrono::milliseconds(CONNECT_TIMEOUT_MS))
+                dropAttempt(i, "timed out");
+            else
+                i++;
+            continue;
+        }
+
+        int err = 0;
+        socklen_t len = sizeof(err);
+        if (getsockopt(attempts[i].fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0)
+            err = errno;
+
+        if (err != 0)
+        {
+            dropAttempt(i, strerror(err));
+            continue;
+        }
+
+        // jeet gaya, baaki sab band
+        fd = attempts[i].fd;
+        epoll_ctl(raceFd, EPOLL_CTL_DEL, fd, nullptr);
+        DnsCache::instance().rememberWinner(host, port, addresses[attempts[i].address]);
+        Metrics::instance().observe(Phase::Connect, now - raceStartedAt);
+        Metrics::instance().add(Counter::ConnectionsOpened);
+        attempts.erase(attempts.begin() + i);
+        reset();
+        return true;
+    }
+
+    // a failed attempt lets the next address start right away
+    if (!attempts.empty() || nextAddress == addresses.size())
+        return false;
+
+    nextAttemptAt = now;
+    return false;
+}
+
+void TcpConnector::dropAttempt(size_t i, const std::string &error)
+{
+    lastError = addresses[attempts[i].address].toString() + " " + error;
+    close(attempts[i].fd);
+    attempts.erase(attempts.begin() + i);
+}
+
+// wake the race up for the next attempt start or the earliest attempt timeout
+void TcpConnector::armTimer()
+{
+    auto deadline = std::chrono::steady_clock::time_point::max();
+
+    if (nextAddress < addresses.size())
+        deadline = nextAttemptAt;
+    for (const Attempt &attempt : attempts)
+        deadline = std::min(deadline, attempt.startedAt + std::chrono::milliseconds(CONNECT_TIMEOUT_MS));
+
+    auto wait = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - std::chrono::steady_clock::now());
+    if (wait.count() <= 0)
+        wait = std::chrono::nanoseconds(1); // zero would disarm the timer
+
+    itimerspec spec{};
+    spec.it_value.tv_sec = wait.count() / 1000000000;
+    spec.it_value.tv_nsec = wait.count() % 1000000000;
+    timerfd_settime(timerFd, 0, &spec, nullptr);
+}
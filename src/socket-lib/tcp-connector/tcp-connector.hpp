@@ -0,0 +1,81 @@
+#pragma once
+
+#include "../isocket/isocket.hpp"
+#include "../dns-cache/dns-cache.hpp"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#define CONNECTION_ATTEMPT_DELAY_MS 250 // RFC 8305 ke hisaab se agla address itni der baad
+#define CONNECT_TIMEOUT_MS 10000        // a single attempt is given up after this long
+
+// opens the TCP connection for both socket kinds. the resolved addresses are
+// raced Happy Eyeballs style (RFC 8305): a new attempt starts every 250ms or as
+// soon as the previous one fails, the first to connect wins and the rest are
+// closed. while racing, an epoll fd watching every attempt and a timer is the
+// fd to wait on, so the race runs inside an event loop as well. a host missing
+// from the dns cache is resolved on a helper thread for the same reason.
+class TcpConnector
+{
+    // a getaddrinfo running on its own thread, the eventfd turns readable when it is done
+    struct Lookup
+    {
+        std::mutex mutex;
+        bool done = false;
+        std::vector<ResolvedAddress> addresses;
+        std::string error;
+        int eventFd = -1;
+
+        ~Lookup();
+    };
+
+    struct Attempt
+    {
+        int fd;
+        size_t address; // index into addresses
+        std::chrono::steady_clock::time_point startedAt;
+    };
+
+    std::string host, port;
+    std::vector<ResolvedAddress> addresses;
+    size_t nextAddress;             // first address not tried yet
+    std::vector<Attempt> attempts;  // connects in progress
+    std::shared_ptr<Lookup> lookup; // resolution in progress, the thread keeps it alive if we give up
+    std::chrono::steady_clock::time_point nextAttemptAt;
+    std::chrono::steady_clock::time_point raceStartedAt; // after the addresses were resolved
+    int raceFd;                     // epoll fd over the attempts and the timer, -1 when idle
+    int timerFd;
+    std::string lastError;
+
+public:
+    TcpConnector(const std::string &host, const std::string &port);
+    ~TcpConnector();
+    TcpConnector(const TcpConnector &) = delete;
+    TcpConnector &operator=(const TcpConnector &) = delete;
+
+    int connect();                  // blocking connect, returns the connected fd
+    IoStatus connectStep(int &fd);  // Done sets fd to the connected non-blocking socket
+    int getPendingFd() const;       // fd to wait on for readability while connecting
+    void reset();
+
+private:
+    void begin();
+    bool finishLookup(); // true once the addresses are there
+    void startAttempt();
+    bool finishAttempts(int &fd);
+    void dropAttempt(size_t i, const std::string &error);
+    void armTimer();
+};
@@ -1,7 +1,8 @@
 #include "tcp-socket.hpp"
 
 // create a TCP socket from the provided host and port
-TcpSocket::TcpSocket(const std::string &h, const std::string &p) : sockfd(-1), host(h), port(p) {}
+TcpSocket::TcpSocket(const std::string &h, const std::string &p)
+    : sockfd(-1), host(h), port(p), connector(h, p), nonBlocking(false) {}
 
 TcpSocket::~TcpSocket()
 {
@@ -11,37 +12,7 @@ TcpSocket::~TcpSocket()
 // create a TCP connection to the server
 void TcpSocket::connectToServer()
 {
-    struct addrinfo hints{}, *res;
-    hints.ai_family = AF_INET;
-    hints.ai_socktype = SOCK_STREAM;
-
-    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &res) != 0)
-        throw std::runtime_error("getaddrinfo failed");
-
-    const struct addrinfo *temp = res;
-    while (temp != nullptr)
-    {
-        int sockfd_temp = socket(temp->ai_family, temp->ai_socktype, temp->ai_protocol);
-        if (sockfd_temp < 0)
-        {
-            temp = temp->ai_next;
-            continue;
-        }
-
-        if (::connect(sockfd_temp, temp->ai_addr, temp->ai_addrlen) == 0)
-        {
-            sockfd = sockfd_temp; // Success => save
-            break;
-        }
-
-        close(sockfd_temp);
-        temp = temp->ai_next;
-    }
-
-    freeaddrinfo(res);
-
-    if (temp == nullptr)
-        throw std::runtime_error("connection failed");
+    sockfd = connector.connect();
 
     std::clog << "connected to server" << std::endl;
 }
@@ -75,29 +46,135 @@ std::string TcpSocket::receiveAll()
     return result;
 }
 
-// receive some specified amount of data from the peer
+// receive at most the specified amount of data from the peer
 std::string TcpSocket::receiveSome(const int size)
 {
-    char buffer[1024];
-    int totalLength = 0;
-    std::string result;
+    std::string result(size, '\0');
+    size_t bytesRead = receiveInto(std::span<char>(result.data(), result.size()));
+    result.resize(bytesRead);
+    return result;
+}
 
-    while (totalLength < size)
+// receive directly into the provided buffer with a single recv
+size_t TcpSocket::receiveInto(std::span<char> buffer)
+{
+    while (true)
     {
-        int bytesRead = recv(this->sockfd, buffer, sizeof(buffer) - 1, 0);
+        ssize_t bytesRead = recv(this->sockfd, buffer.data(), buffer.size(), 0);
 
-        if (bytesRead < 0)
+        if (bytesRead >= 0)
+            return bytesRead;
+
+        if (errno != EINTR)
             throw std::runtime_error("failed to recv data");
+    }
+}
+
+// receive directly into the provided buffers with a single readv
+size_t TcpSocket::receiveInto(const struct iovec *iov, const int iovcnt)
+{
+    while (true)
+    {
+        ssize_t bytesRead = readv(this->sockfd, iov, iovcnt);
 
-        // when done receiving all the data from peer
-        if (bytesRead == 0)
-            break;
+        if (bytesRead >= 0)
+            return bytesRead;
 
-        // append the received data
-        totalLength += bytesRead;
-        result.append(buffer);
+        if (errno != EINTR)
+            throw std::runtime_error("failed to recv data");
     }
-    return result;
+}
+
+// the bytes on a plain TCP socket are the payload itself
+int TcpSocket::getRawFd() const
+{
+    return this->sockfd;
+}
+
+// switch the socket between blocking and non-blocking mode
+void TcpSocket::setNonBlocking(bool enabled)
+{
+    this->nonBlocking = enabled;
+
+    if (sockfd < 0)
+        return;
+
+    int flags = fcntl(sockfd, F_GETFL);
+    fcntl(sockfd, F_SETFL, enabled ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK));
+}
+
+// connect without waiting for the handshake, call again once the fd is writable
+IoStatus TcpSocket::connectStep()
+{
+    if (sockfd >= 0)
+        return IoStatus::Done;
+
+    IoStatus status = connector.connectStep(sockfd);
+    if (status == IoStatus::Done)
+        setNonBlocking(nonBlocking);
+
+    return status;
+}
+
+// send as much as the socket takes right now
+IoStatus TcpSocket::trySend(std::string_view data, size_t &sent)
+{
+    sent = 0;
+    while (sent < data.size())
+    {
+        ssize_t n = send(sockfd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n >= 0)
+        {
+            sent += n;
+            continue;
+        }
+
+        if (errno == EINTR)
+            continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return IoStatus::WantWrite;
+
+        throw std::runtime_error("send failed");
+    }
+    return IoStatus::Done;
+}
+
+// receive what is available right now
+IoStatus TcpSocket::tryReceive(std::span<char> buffer, size_t &received)
+{
+    received = 0;
+    while (true)
+    {
+        ssize_t n = recv(sockfd, buffer.data(), buffer.size(), 0);
+        if (n >= 0)
+        {
+            received = n;
+            return IoStatus::Done;
+        }
+
+        if (errno == EINTR)
+            continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return IoStatus::WantRead;
+
+        throw std::runtime_error(std::string("failed to recv data: ") + strerror(errno));
+    }
+}
+
+// the connected socket or the one still connecting
+int TcpSocket::getPollFd() const
+{
+    return sockfd >= 0 ? sockfd : connector.getPendingFd();
+}
+
+// an idle connection must not be readable, readable means closed or unexpected bytes
+bool TcpSocket::isReusable()
+{
+    if (sockfd < 0)
+        return false;
+
+    pollfd pfd{sockfd, POLLIN, 0};
+    return poll(&pfd, 1, 0) == 0;
 }
 
 // close the TCP connection 
@@ -108,4 +185,5 @@ void TcpSocket::closeConnection()
         close(sockfd);
         sockfd = -1;
     }
+    connector.reset();
 }
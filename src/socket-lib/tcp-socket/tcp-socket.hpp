@@ -1,10 +1,14 @@
 #pragma once
 
 #include "../isocket/isocket.hpp"
+#include "../tcp-connector/tcp-connector.hpp"
 #include <string>
 #include <stdexcept>
+#include <cerrno>
 #include <cstring>
 #include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <netdb.h>
 #include <sys/socket.h>
 #include <iostream>
@@ -14,6 +18,8 @@ class TcpSocket : public ISocket
 {
     int sockfd;
     std::string host, port;
+    TcpConnector connector;
+    bool nonBlocking;
 
 public:
     TcpSocket(const std::string &h, const std::string &p);
@@ -27,5 +33,22 @@ public:
 
     std::string receiveSome(const int size) override;
 
+    size_t receiveInto(std::span<char> buffer) override;
+
+    size_t receiveInto(const struct iovec *iov, const int iovcnt) override;
+
+    int getRawFd() const override;
+
+    void setNonBlocking(bool enabled) override;
+
+    IoStatus connectStep() override;
+
+    IoStatus trySend(std::string_view data, size_t &sent) override;
+
+    IoStatus tryReceive(std::span<char> buffer, size_t &received) override;
+
+    int getPollFd() const override;
+    bool isReusable() override;
+
     void closeConnection() override;
-};
\ No newline at end of file
+};
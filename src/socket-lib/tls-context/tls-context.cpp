@@ -0,0 +1,124 @@
+#include "tls-context.hpp"
+
+TlsContext::TlsContext() : ctx(nullptr), sessions(), mutex(), resumed(0), full(0), keyIndex(-1)
+{
+    OPENSSL_init_ssl(0, nullptr);
+
+    ctx = SSL_CTX_new(TLS_client_method());
+    if (!ctx)
+    {
+        ERR_print_errors_fp(stderr);
+        throw std::runtime_error("failed to create ssl context!");
+    }
+
+    // currently dont verify certificate
+    SSL_CTX_set_verify(ctx, SSL_VERIFY_NONE, nullptr);
+
+    // sessions are kept by us per host:port, OpenSSL's own client cache cannot look them up
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(ctx, &TlsContext::onNewSession);
+
+    setKernelTls(true);
+
+    keyIndex = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+}
+
+TlsContext::~TlsContext()
+{
+    clearSessions();
+    SSL_CTX_free(ctx);
+}
+
+// created on first use, lives till the process exits
+TlsContext &TlsContext::instance()
+{
+    static TlsContext context;
+    return context;
+}
+
+SSL *TlsContext::newSsl(const std::string &sessionKey)
+{
+    SSL *ssl = SSL_new(ctx);
+    if (!ssl)
+    {
+        ERR_print_errors_fp(stderr);
+        throw std::runtime_error("failed to create ssl session!");
+    }
+
+    // the key string is owned by the SslSocket which outlives its SSL
+    SSL_set_ex_data(ssl, keyIndex, (void *)&sessionKey);
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = sessions.find(sessionKey);
+    if (it != sessions.end())
+        SSL_set_session(ssl, it->second);
+
+    return ssl;
+}
+
+void TlsContext::recordHandshake(SSL *ssl)
+{
+    if (SSL_session_reused(ssl))
+        resumed++;
+    else
+        full++;
+}
+
+// OpenSSL tries kTLS after every handshake and quietly stays in user space when
+// the kernel lacks the tls module or the cipher isnt supported there
+void TlsContext::setKernelTls(bool enabled)
+{
+#ifdef SSL_OP_ENABLE_KTLS
+    if (enabled)
+        SSL_CTX_set_options(ctx, SSL_OP_ENABLE_KTLS);
+    else
+        SSL_CTX_clear_options(ctx, SSL_OP_ENABLE_KTLS);
+#else
+    (void)enabled;
+#endif
+}
+
+void TlsContext::clearSessions()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (auto &[key, session] : sessions)
+        SSL_SESSION_free(session);
+    sessions.clear();
+}
+
+size_t TlsContext::getResumedHandshakes() const
+{
+    return resumed;
+}
+
+size_t TlsContext::getFullHandshakes() const
+{
+    return full;
+}
+
+// keep only the newest session of a host:port
+void TlsContext::storeSession(const std::string &sessionKey, SSL_SESSION *session)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    SSL_SESSION *&slot = sessions[sessionKey];
+    if (slot)
+        SSL_SESSION_free(slot);
+    slot = session;
+}
+
+// called by OpenSSL for every session or TLS 1.3 ticket the server sends
+int TlsContext::onNewSession(SSL *ssl, SSL_SESSION *session)
+{
+    TlsContext &context = instance();
+
+    auto *sessionKey = static_cast<const std::string *>(SSL_get_ex_data(ssl, context.keyIndex));
+    if (!sessionKey || !SSL_SESSION_is_resumable(session))
+        return 0;
+
+    // returning 1 keeps the reference OpenSSL passed us
+    context.storeSession(*sessionKey, session);
+    return 1;
+}
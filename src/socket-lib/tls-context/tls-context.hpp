@@ -0,0 +1,44 @@
+#pragma once
+
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+// the client SSL_CTX shared by every SslSocket of the process, along with the
+// sessions servers gave us so the next connection to the same host:port can
+// use an abbreviated handshake
+class TlsContext
+{
+    SSL_CTX *ctx;
+    std::unordered_map<std::string, SSL_SESSION *> sessions; // latest session per host:port
+    std::mutex mutex;
+    std::atomic<size_t> resumed;
+    std::atomic<size_t> full;
+    int keyIndex; // ex data slot of the SSL holding its session cache key
+
+    TlsContext();
+
+public:
+    ~TlsContext();
+    TlsContext(const TlsContext &) = delete;
+    TlsContext &operator=(const TlsContext &) = delete;
+
+    static TlsContext &instance();
+
+    // a new SSL for a connection to host:port, resuming the cached session if there is one
+    SSL *newSsl(const std::string &sessionKey);
+    void recordHandshake(SSL *ssl); // counts whether the finished handshake was resumed
+    void setKernelTls(bool enabled); // let the kernel take over the record layer where it can, on by default
+    void clearSessions();
+
+    size_t getResumedHandshakes() const;
+    size_t getFullHandshakes() const;
+
+private:
+    void storeSession(const std::string &sessionKey, SSL_SESSION *session);
+    static int onNewSession(SSL *ssl, SSL_SESSION *session);
+};
@@ -9,14 +9,17 @@ ParsedUrl parseUrl(const std::string &url)
     ParsedUrl result;
     std::string temp = url;
 
-    if (temp.find("https") != std::string::npos)
-    {
-        result.port = "443";
-    }
-
     size_t hostPos = temp.find("://");
     if (hostPos != std::string::npos)
+    {
+        result.scheme = temp.substr(0, hostPos);
         temp = temp.substr(hostPos + 3);
+    }
+
+    if (result.scheme == "https")
+    {
+        result.port = "443";
+    }
 
     size_t pathPos = temp.find('/');
 
@@ -39,6 +42,34 @@ ParsedUrl parseUrl(const std::string &url)
     return result;
 }
 
+// parses "bytes <start>-<end>/<total>" and "bytes */<total>"
+ContentRange parseContentRange(const std::string &value)
+{
+    ContentRange range;
+
+    if (!value.starts_with("bytes "))
+        return range;
+
+    std::string spec = value.substr(6);
+    size_t slash = spec.find('/');
+    if (slash == std::string::npos)
+        return range;
+
+    std::string total = spec.substr(slash + 1);
+    if (!total.empty() && total != "*")
+        range.total = std::stoll(total);
+
+    std::string bytes = spec.substr(0, slash);
+    size_t dash = bytes.find('-');
+    if (bytes != "*" && dash != std::string::npos)
+    {
+        range.start = std::stoll(bytes.substr(0, dash));
+        range.end = std::stoll(bytes.substr(dash + 1));
+    }
+
+    return range;
+}
+
 // extract filename and extension from the content type and content disposition
 std::pair<std::string, std::string> getFilenameAndExtension(
     const std::string &contentDisposition,
@@ -134,28 +165,6 @@ long long getFileSizeIfPresent(const std::string &filename)
     return -1;
 }
 
-// saves the provided data to the given file
-void saveToFile(const std::string &filename, const std::string &data)
-{
-    // std::clog << "[DEBUG] Trying to open file: '" << filename << "'" << std::endl;
-
-    std::ofstream file(filename, std::ios::binary | std::ios::app);
-    if (!file)
-    {
-        int err = errno; // system error code
-        std::clog << "[ERROR] Failed to open file. errno = " << err
-                  << " (" << std::strerror(err) << ")" << std::endl;
-
-        auto dir = std::filesystem::path(filename).parent_path();
-        std::clog << "[DEBUG] Parent directory: '" << dir.string() << "'" << std::endl;
-        std::clog << "[DEBUG] Directory exists: " << (std::filesystem::exists(dir) ? "YES" : "NO") << std::endl;
-
-        throw std::runtime_error("failed to create/open the file");
-    }
-
-    file.write(data.c_str(), data.size());
-}
-
 // converts hexdecimal string to decimal number
 int hexaDecimalToDecimal(const std::string &num)
 {
@@ -14,13 +14,24 @@
 
 struct ParsedUrl
 {
+    std::string scheme = "http";
     std::string host;
     std::string path = "/";
     std::string port = "80";
 };
 
+// value of the Content-Range header, -1 for the parts not present
+struct ContentRange
+{
+    long long start = -1;
+    long long end = -1;
+    long long total = -1;
+};
+
 ParsedUrl parseUrl(const std::string &url);
 
+ContentRange parseContentRange(const std::string &value);
+
 std::pair<std::string, std::string> getFilenameAndExtension(
     const std::string &contentDisposition,
     const std::string &contentType,
@@ -28,8 +39,6 @@ std::pair<std::string, std::string> getFilenameAndExtension(
 
 std::vector<std::string> split(const std::string &str, const char &delim);
 
-void saveToFile(const std::string &filename, const std::string &data);
-
 long long getFileSizeIfPresent(const std::string& filename);
 
 int hexaDecimalToDecimal(const std::string &num);
\ No newline at end of file